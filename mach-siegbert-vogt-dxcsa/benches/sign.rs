@@ -0,0 +1,90 @@
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+
+const REAL_SIGNED_BLOB: &[u8] = include_bytes!("../mipmap.dxil.blob");
+const REAL_SIGNED_COMPLEX_BLOB: &[u8] = include_bytes!("../realsigned_complex.blob");
+
+/// A deterministic blob of `len` bytes, large enough to hold the DXBC header.
+fn synthetic_blob(len: usize) -> Vec<u8> {
+    let mut state = 0x2545f491u32;
+    (0..len.max(20))
+        .map(|_| {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            state as u8
+        })
+        .collect()
+}
+
+fn blobs() -> Vec<(String, Vec<u8>)> {
+    let mut blobs = vec![
+        (String::from("mipmap"), REAL_SIGNED_BLOB.to_vec()),
+        (String::from("complex"), REAL_SIGNED_COMPLEX_BLOB.to_vec()),
+    ];
+    for len in [4 << 10, 64 << 10, 1 << 20, 4 << 20] {
+        blobs.push((format!("synthetic/{}KiB", len >> 10), synthetic_blob(len)));
+    }
+    blobs
+}
+
+fn sign(c: &mut Criterion) {
+    let mut group = c.benchmark_group("sign");
+    for (name, blob) in blobs() {
+        group.throughput(Throughput::Bytes(blob.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(name), &blob, |b, blob| {
+            let mut out = [0u32; 4];
+            b.iter(|| mach_siegbert_vogt_dxcsa::sign(black_box(blob), &mut out))
+        });
+    }
+    group.finish();
+}
+
+fn sign_many(c: &mut Criterion) {
+    let mut group = c.benchmark_group("sign_many");
+    for (count, len) in [(64, 4 << 10), (64, 64 << 10), (16, 1 << 20)] {
+        let mut blobs: Vec<Vec<u8>> = (0..count).map(|i| synthetic_blob(len + i * 64)).collect();
+        let bytes: usize = blobs.iter().map(Vec::len).sum();
+
+        group.throughput(Throughput::Bytes(bytes as u64));
+        group.bench_function(
+            BenchmarkId::from_parameter(format!("{count}x{}KiB", len >> 10)),
+            |b| {
+                b.iter(|| {
+                    let mut slices: Vec<&mut [u8]> =
+                        blobs.iter_mut().map(Vec::as_mut_slice).collect();
+                    mach_siegbert_vogt_dxcsa::sign_many(black_box(&mut slices))
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+/// Verify a signed archive of `count` blobs of about `len` bytes, one at a time and all at once.
+fn verify(c: &mut Criterion) {
+    let mut group = c.benchmark_group("verify");
+    for (count, len) in [(1024, 4 << 10), (1024, 64 << 10), (64, 1 << 20)] {
+        let mut blobs: Vec<Vec<u8>> = (0..count).map(|i| synthetic_blob(len + i * 64)).collect();
+        for blob in &mut blobs {
+            mach_siegbert_vogt_dxcsa::sign_in_place(blob);
+        }
+        let bytes: usize = blobs.iter().map(Vec::len).sum();
+        let archive = format!("{count}x{}KiB", len >> 10);
+
+        group.throughput(Throughput::Bytes(bytes as u64));
+        group.bench_function(BenchmarkId::new("verify", &archive), |b| {
+            b.iter(|| {
+                black_box(&blobs)
+                    .iter()
+                    .all(|blob| mach_siegbert_vogt_dxcsa::verify(blob))
+            })
+        });
+        group.bench_function(BenchmarkId::new("verify_many", &archive), |b| {
+            b.iter(|| mach_siegbert_vogt_dxcsa::verify_many(black_box(&blobs)))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, sign, sign_many, verify);
+criterion_main!(benches);
@@ -1,3 +1,15 @@
+mod multi;
+mod stream;
+
+pub use multi::{sign_many, verify_many};
+pub use stream::Signer;
+
+/// Note: first 4 bytes of bin are "DXBC" (IL) header/file-magic, then 16-byte signing hash,
+/// then remainder of the file contents.
+const SECRET_HASH_OFFSET: usize = 20;
+
+const INIT: [u32; 4] = [0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476];
+
 const PADDING: [u8; 64] = [
     0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -12,7 +24,7 @@ struct Context {
     buf: [u32; 4],
 }
 
-fn transform(state: &mut [u32; 4], input: &[u32; 16]) {
+const fn transform(state: &mut [u32; 4], input: &[u32; 16]) {
     let (mut a, mut b, mut c, mut d) = (state[0], state[1], state[2], state[3]);
     macro_rules! add(
         ($a:expr, $b:expr) => ($a.wrapping_add($b));
@@ -159,12 +171,11 @@ impl Context {
         Context {
             input: [0u8; 64],
             i: [0, 0],
-            buf: [0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476],
+            buf: INIT,
         }
     }
 
-    fn update(&mut self, buf: &[u8]) {
-        let mut input = [0u32; 16];
+    fn update(&mut self, mut buf: &[u8]) {
         let mut mdi = ((self.i[0] >> 3) & 0x3f) as usize;
 
         // Update # of bits
@@ -177,79 +188,138 @@ impl Context {
         self.i[0] = self.i[0].wrapping_add(length << 3);
         self.i[1] = self.i[1].wrapping_add(length >> 29);
 
-        for &byte in buf {
-            self.input[mdi] = byte;
-            mdi += 1;
-
-            if mdi == 0x40 {
-                let mut j = 0;
-                for i in 0..16 {
-                    input[i] = (self.input[j + 3] as u32) << 24;
-                    input[i] |= (self.input[j + 2] as u32) << 16;
-                    input[i] |= (self.input[j + 1] as u32) << 8;
-                    input[i] |= self.input[j] as u32;
-                    j += 4;
-                }
+        // Complete the block left partially filled by a previous update.
+        if mdi != 0 {
+            let head = buf.len().min(0x40 - mdi);
+            self.input[mdi..mdi + head].copy_from_slice(&buf[..head]);
+            buf = &buf[head..];
+            mdi += head;
 
-                transform(&mut self.buf, &input);
-                mdi = 0;
+            if mdi < 0x40 {
+                return;
             }
-        }
-    }
-}
 
-/// Sign the DXIL blob with Mach-Siegbert-Vogt DXCSA
-pub fn sign(blob: &[u8], out: &mut [u32; 4]) {
-    const SECRET_HASH_OFFSET: usize = 20;
-    let mut context = Context::new();
+            transform(&mut self.buf, &load_block(&self.input));
+        }
 
-    // Note: first 4 bytes of bin are "DXBC" (IL) header/file-magic, then 16-byte signing hash,
-    // then remainder of the file contents.
-    let blob = &blob[SECRET_HASH_OFFSET..];
+        // Hash whole blocks straight from the input without buffering them.
+        let mut chunks = buf.chunks_exact(0x40);
+        for chunk in &mut chunks {
+            transform(&mut self.buf, &load_block(chunk.try_into().unwrap()));
+        }
 
-    let len = blob.len() as u32;
-    let num_bits = len * 8;
-    let full_chunks_size = len & 0xffffffc0;
+        let tail = chunks.remainder();
+        self.input[..tail.len()].copy_from_slice(tail);
+    }
+}
 
-    context.update(&blob[..full_chunks_size as usize]);
+/// Load a 64-byte block as 16 little-endian words.
+#[inline(always)]
+const fn load_block(bytes: &[u8; 64]) -> [u32; 16] {
+    let mut block = [0u32; 16];
+    let mut i = 0;
+    while i < 16 {
+        block[i] = u32::from_le_bytes([
+            bytes[4 * i],
+            bytes[4 * i + 1],
+            bytes[4 * i + 2],
+            bytes[4 * i + 3],
+        ]);
+        i += 1;
+    }
+    block
+}
 
-    let last_chunk_data = &blob[full_chunks_size as usize..];
-    let padding_size = 64 - (blob.len() - full_chunks_size as usize);
+/// The blocks that finish the DXCSA message after the full 64-byte chunks of `body`.
+///
+/// DXCSA departs from MD5 in how the message is terminated. If the trailing partial chunk leaves
+/// room, the bit count is placed before it in a single final block. Otherwise the partial chunk is
+/// padded into its own block, followed by a block holding only the bit count.
+///
+/// Returns the blocks and how many of them are used.
+fn tail_blocks(body: &[u8]) -> ([[u32; 16]; 2], usize) {
+    termination_blocks(body.len(), &body[body.len() & !0x3f..])
+}
 
-    if last_chunk_data.len() >= 56 {
-        context.update(last_chunk_data);
+/// The blocks that finish a DXCSA message of `len` bytes whose trailing partial chunk is
+/// `last_chunk_data`.
+const fn termination_blocks(len: usize, last_chunk_data: &[u8]) -> ([[u32; 16]; 2], usize) {
+    let num_bits = (len as u32).wrapping_mul(8);
+    let separate_length = last_chunk_data.len() >= 56;
 
-        // Pad to 56 mod 64
-        context.update(&PADDING[0..padding_size]);
+    let mut bytes = [0u8; 64];
+    let mut blocks = [[0u32; 16]; 2];
 
-        let mut input = [0u32; 16];
-        input[0] = num_bits;
-        input[15] = (num_bits >> 2) | 1;
-        transform(&mut context.buf, &input);
+    // The bit count goes before the data when it fits in the same block.
+    let offset = if separate_length {
+        0
     } else {
-        let num_bits_bytes = bytemuck::bytes_of(&num_bits);
-        context.update(num_bits_bytes);
-        if last_chunk_data.len() != 0 {
-            context.update(last_chunk_data);
-        }
-
-        // Adjust for the space used for num_bits
-        let padding_size = padding_size - ::core::mem::size_of::<u32>();
-
-        // Pad to 56 mod 64
-        context.input[last_chunk_data.len() + ::core::mem::size_of::<u32>()..]
-            .copy_from_slice(&PADDING[0..padding_size]);
+        let num_bits = num_bits.to_le_bytes();
+        bytes[0] = num_bits[0];
+        bytes[1] = num_bits[1];
+        bytes[2] = num_bits[2];
+        bytes[3] = num_bits[3];
+        4
+    };
+
+    let mut i = 0;
+    while i < last_chunk_data.len() {
+        bytes[offset + i] = last_chunk_data[i];
+        i += 1;
+    }
+    bytes[offset + last_chunk_data.len()] = PADDING[0];
+    blocks[0] = load_block(&bytes);
 
-        let num_bits_shift = num_bits >> 2 | 1;
+    if separate_length {
+        blocks[1][0] = num_bits;
+        blocks[1][15] = (num_bits >> 2) | 1;
+        (blocks, 2)
+    } else {
+        blocks[0][15] = (num_bits >> 2) | 1;
+        (blocks, 1)
+    }
+}
 
-        bytemuck::cast_slice_mut::<_, u32>(&mut context.input)[15] = num_bits_shift;
+/// Compute the Mach-Siegbert-Vogt DXCSA signature of a DXIL blob.
+///
+/// This is a `const fn`, so blobs embedded with `include_bytes!` can be signed or checked at
+/// compile time. See [`signed`] and [`verify`].
+///
+/// # Compile-time evaluation
+/// The compiler denies constant evaluation that runs for too long with the
+/// `long_running_const_eval` lint. Hashing a blob at compile time hits that limit at roughly
+/// 512 KiB. Allow the lint on the item that hashes a larger blob:
+///
+/// ```ignore
+/// #[allow(long_running_const_eval)]
+/// const SHADER: [u8; LEN] = mach_siegbert_vogt_dxcsa::signed(include_bytes!("shader.dxil"));
+/// ```
+///
+/// # Panics
+/// Panics if the blob is shorter than the DXBC header.
+pub const fn digest(blob: &[u8]) -> [u32; 4] {
+    let (_, body) = blob.split_at(SECRET_HASH_OFFSET);
+
+    let mut state = INIT;
+    let mut rest = body;
+    while let Some((block, tail)) = rest.split_first_chunk::<64>() {
+        transform(&mut state, &load_block(block));
+        rest = tail;
+    }
 
-        let mut input = [0u32; 16];
-        input.copy_from_slice(bytemuck::cast_slice(&context.input));
-        transform(&mut context.buf, &input);
+    let (blocks, used) = termination_blocks(body.len(), rest);
+    let mut i = 0;
+    while i < used {
+        transform(&mut state, &blocks[i]);
+        i += 1;
     }
 
-    out.copy_from_slice(&context.buf);
+    state
+}
+
+/// Sign the DXIL blob with Mach-Siegbert-Vogt DXCSA
+pub fn sign(blob: &[u8], out: &mut [u32; 4]) {
+    *out = digest(blob);
 }
 
 /// Sign the DXIL blob in place with Mach-Siegbert-Vogt DXCSA
@@ -259,9 +329,72 @@ pub fn sign_in_place(blob: &mut [u8]) {
     blob[4..20].copy_from_slice(bytemuck::cast_slice(&signature));
 }
 
+/// Return a signed copy of a DXIL blob.
+///
+/// Usable in `const` items, to embed a blob that is signed at compile time:
+///
+/// ```
+/// # const fn unsigned_blob() -> [u8; 84] { [0; 84] }
+/// const BLOB: [u8; 84] = mach_siegbert_vogt_dxcsa::signed(&unsigned_blob());
+/// const _: () = assert!(mach_siegbert_vogt_dxcsa::verify(&BLOB));
+/// ```
+///
+/// Blobs of roughly 512 KiB and larger need `long_running_const_eval` allowed on the item; see
+/// [`digest`].
+///
+/// # Panics
+/// Panics if the blob is shorter than the DXBC header.
+pub const fn signed<const N: usize>(blob: &[u8; N]) -> [u8; N] {
+    let signature = digest(blob);
+
+    let mut out = *blob;
+    let mut i = 0;
+    while i < 4 {
+        let bytes = signature[i].to_ne_bytes();
+        let mut j = 0;
+        while j < 4 {
+            out[4 + 4 * i + j] = bytes[j];
+            j += 1;
+        }
+        i += 1;
+    }
+    out
+}
+
+/// Check the Mach-Siegbert-Vogt DXCSA signature of a DXIL blob.
+///
+/// The signature is recomputed over the blob in place and compared to the one stored in it.
+/// Blobs too short to hold a signature are invalid. Like [`digest`], this can be evaluated at
+/// compile time, with the same limit on blob size.
+pub const fn verify(blob: &[u8]) -> bool {
+    if blob.len() < SECRET_HASH_OFFSET {
+        return false;
+    }
+
+    signature_matches(blob, &digest(blob))
+}
+
+const fn signature_matches(blob: &[u8], signature: &[u32; 4]) -> bool {
+    let mut i = 0;
+    while i < 4 {
+        let bytes = signature[i].to_ne_bytes();
+        let mut j = 0;
+        while j < 4 {
+            if blob[4 + 4 * i + j] != bytes[j] {
+                return false;
+            }
+            j += 1;
+        }
+        i += 1;
+    }
+    true
+}
+
 #[cfg(test)]
 mod test {
-    use crate::sign;
+    use crate::{
+        digest, multi, sign, sign_in_place, sign_many, signed, verify, verify_many, Signer,
+    };
 
     const REAL_SIGNED_BLOB: &[u8] = include_bytes!("../mipmap.dxil.blob");
     const REAL_SIGNED_COMPLEX_BLOB: &[u8] = include_bytes!("../realsigned_complex.blob");
@@ -285,4 +418,109 @@ mod test {
 
         assert_eq!(sig, bytemuck::cast_slice(&out_sig));
     }
+
+    /// Blobs of every length class around the 56 and 64 byte boundaries, filled with noise.
+    fn synthetic_blobs() -> Vec<Vec<u8>> {
+        let mut seed = 0x2545f491u32;
+        (20..20 + 300)
+            .map(|len| {
+                (0..len)
+                    .map(|_| {
+                        seed ^= seed << 13;
+                        seed ^= seed >> 17;
+                        seed ^= seed << 5;
+                        seed as u8
+                    })
+                    .collect()
+            })
+            .chain([REAL_SIGNED_BLOB.to_vec(), REAL_SIGNED_COMPLEX_BLOB.to_vec()])
+            .collect()
+    }
+
+    fn assert_sign_many(sign_many: impl Fn(&mut [&mut [u8]])) {
+        let mut expected = synthetic_blobs();
+        for blob in &mut expected {
+            sign_in_place(blob);
+        }
+
+        let mut actual = synthetic_blobs();
+        let mut blobs: Vec<&mut [u8]> = actual.iter_mut().map(Vec::as_mut_slice).collect();
+        sign_many(&mut blobs);
+
+        assert_eq!(expected, actual);
+    }
+
+    #[test]
+    pub fn test_sign_many() {
+        assert_sign_many(sign_many);
+    }
+
+    #[test]
+    pub fn test_sign_many_lanes() {
+        assert_sign_many(multi::sign_many_lanes::<1>);
+        assert_sign_many(multi::sign_many_lanes::<4>);
+        assert_sign_many(multi::sign_many_lanes::<8>);
+        assert_sign_many(multi::sign_many_lanes::<16>);
+    }
+
+    #[test]
+    pub fn test_signer() {
+        for blob in synthetic_blobs() {
+            let mut expected = [0u32; 4];
+            sign(&blob, &mut expected);
+
+            for chunk_size in [1, 3, 20, 63, 64, 65, 200, blob.len()] {
+                let mut signer = Signer::new();
+                for chunk in blob.chunks(chunk_size) {
+                    signer.update(chunk);
+                }
+                assert_eq!(expected, signer.finalize(), "chunk size {chunk_size}");
+            }
+        }
+    }
+
+    #[test]
+    pub fn test_verify() {
+        assert!(verify(REAL_SIGNED_BLOB));
+        assert!(verify(REAL_SIGNED_COMPLEX_BLOB));
+        assert!(!verify(&REAL_SIGNED_BLOB[..19]));
+
+        let mut tampered = REAL_SIGNED_BLOB.to_vec();
+        *tampered.last_mut().unwrap() ^= 1;
+        assert!(!verify(&tampered));
+    }
+
+    #[test]
+    pub fn test_verify_many() {
+        let mut blobs = synthetic_blobs();
+        for blob in blobs.iter_mut().step_by(2) {
+            sign_in_place(blob);
+        }
+        blobs.push(vec![0; 19]);
+
+        let expected: Vec<bool> = blobs.iter().map(|blob| verify(blob)).collect();
+        assert!(expected.iter().any(|&valid| valid));
+        assert!(expected.iter().any(|&valid| !valid));
+
+        assert_eq!(expected, verify_many(&blobs));
+    }
+
+    #[test]
+    pub fn test_const() {
+        const SIGNATURE: [u32; 4] = digest(REAL_SIGNED_COMPLEX_BLOB);
+        const _: () = assert!(verify(REAL_SIGNED_BLOB));
+
+        const UNSIGNED: [u8; 84] = [0xa5; 84];
+        const SIGNED: [u8; 84] = signed(&UNSIGNED);
+        const _: () = assert!(!verify(&UNSIGNED));
+        const _: () = assert!(verify(&SIGNED));
+
+        let mut out_sig = [0u32; 4];
+        sign(REAL_SIGNED_COMPLEX_BLOB, &mut out_sig);
+        assert_eq!(SIGNATURE, out_sig);
+
+        let mut expected = UNSIGNED;
+        sign_in_place(&mut expected);
+        assert_eq!(expected, SIGNED);
+    }
 }
@@ -0,0 +1,262 @@
+//! Multi-buffer signing: hash several independent blobs at once, one per SIMD lane.
+
+use crate::{tail_blocks, INIT, SECRET_HASH_OFFSET};
+
+const AC: [u32; 64] = [
+    3614090360, 3905402710, 606105819, 3250441966, 4118548399, 1200080426, 2821735955, 4249261313,
+    1770035416, 2336552879, 4294925233, 2304563134, 1804603682, 4254626195, 2792965006, 1236535329,
+    4129170786, 3225465664, 643717713, 3921069994, 3593408605, 38016083, 3634488961, 3889429448,
+    568446438, 3275163606, 4107603335, 1163531501, 2850285829, 4243563512, 1735328473, 2368359562,
+    4294588738, 2272392833, 1839030562, 4259657740, 2763975236, 1272893353, 4139469664, 3200236656,
+    681279174, 3936430074, 3572445317, 76029189, 3654602809, 3873151461, 530742520, 3299628645,
+    4096336452, 1126891415, 2878612391, 4237533241, 1700485571, 2399980690, 4293915773, 2240044497,
+    1873313359, 4264355552, 2734768916, 1309151649, 4149444226, 3174756917, 718787259, 3951481745,
+];
+
+const SHIFT: [[u32; 4]; 4] = [
+    [7, 12, 17, 22],
+    [5, 9, 14, 20],
+    [4, 11, 16, 23],
+    [6, 10, 15, 21],
+];
+
+/// Message word used by each step.
+const fn message_index(step: usize) -> usize {
+    match step / 16 {
+        0 => step,
+        1 => (1 + 5 * step) % 16,
+        2 => (5 + 3 * step) % 16,
+        _ => (7 * step) % 16,
+    }
+}
+
+/// The MD5 compression function applied to `L` independent states at once.
+///
+/// Every operation is a loop over the lanes, which the compiler lowers to vector instructions
+/// for the enabled target features.
+#[inline(always)]
+fn transform_lanes<const L: usize>(state: &mut [[u32; L]; 4], input: &[[u32; L]; 16]) {
+    let [mut a, mut b, mut c, mut d] = *state;
+
+    macro_rules! rounds(
+        ($round:expr, |$x:ident, $y:ident, $z:ident| $f:expr) => ({
+            for i in 0..16 {
+                let step = $round * 16 + i;
+                let x = &input[message_index(step)];
+                let s = SHIFT[$round][i % 4];
+                let mut next = [0u32; L];
+                for l in 0..L {
+                    let ($x, $y, $z) = (b[l], c[l], d[l]);
+                    next[l] = a[l]
+                        .wrapping_add($f)
+                        .wrapping_add(x[l])
+                        .wrapping_add(AC[step])
+                        .rotate_left(s)
+                        .wrapping_add(b[l]);
+                }
+                a = d;
+                d = c;
+                c = b;
+                b = next;
+            }
+        });
+    );
+
+    rounds!(0, |x, y, z| (x & y) | (!x & z));
+    rounds!(1, |x, y, z| (x & z) | (y & !z));
+    rounds!(2, |x, y, z| x ^ y ^ z);
+    rounds!(3, |x, y, z| y ^ (x | !z));
+
+    for l in 0..L {
+        state[0][l] = state[0][l].wrapping_add(a[l]);
+        state[1][l] = state[1][l].wrapping_add(b[l]);
+        state[2][l] = state[2][l].wrapping_add(c[l]);
+        state[3][l] = state[3][l].wrapping_add(d[l]);
+    }
+}
+
+/// Per-lane progress through a blob.
+#[derive(Copy, Clone)]
+struct Lane {
+    blob: usize,
+    block: usize,
+    full_blocks: usize,
+    blocks: usize,
+    tail: [[u32; 16]; 2],
+}
+
+impl Lane {
+    fn new(blob: usize, body: &[u8]) -> Self {
+        let full_blocks = body.len() / 64;
+        let (tail, tail_len) = tail_blocks(body);
+        Lane {
+            blob,
+            block: 0,
+            full_blocks,
+            blocks: full_blocks + tail_len,
+            tail,
+        }
+    }
+}
+
+/// Start hashing the next pending blob in `lane`, or leave it empty if there are none left.
+#[inline(always)]
+fn fill<const L: usize, B: AsRef<[u8]>>(
+    lane: usize,
+    lanes: &mut [Option<Lane>; L],
+    state: &mut [[u32; L]; 4],
+    pending: &mut impl Iterator<Item = usize>,
+    blobs: &[B],
+) {
+    lanes[lane] = pending
+        .next()
+        .map(|blob| Lane::new(blob, &blobs[blob].as_ref()[SECRET_HASH_OFFSET..]));
+    for (word, init) in state.iter_mut().zip(INIT) {
+        word[lane] = init;
+    }
+}
+
+/// Compute the signature of each of `blobs`, `L` at a time, and pass it to `finish` along with
+/// the index of the blob. Blobs too short to hold a signature are skipped.
+///
+/// Blobs are scheduled longest first, and a lane is refilled with the next blob as soon as its
+/// current one is done, so lanes only idle once fewer than `L` blobs remain.
+#[inline(always)]
+pub(crate) fn digest_many_lanes<const L: usize, B: AsRef<[u8]>>(
+    blobs: &[B],
+    mut finish: impl FnMut(usize, [u32; 4]),
+) {
+    let mut order: Vec<usize> = (0..blobs.len())
+        .filter(|&blob| blobs[blob].as_ref().len() >= SECRET_HASH_OFFSET)
+        .collect();
+    order.sort_unstable_by_key(|&blob| std::cmp::Reverse(blobs[blob].as_ref().len()));
+    let mut pending = order.into_iter();
+
+    let mut lanes: [Option<Lane>; L] = [None; L];
+    let mut state = [[0u32; L]; 4];
+
+    for lane in 0..L {
+        fill(lane, &mut lanes, &mut state, &mut pending, blobs);
+    }
+
+    let mut input = [[0u32; L]; 16];
+    let mut done = [false; L];
+
+    while lanes.iter().any(Option::is_some) {
+        for (l, lane) in lanes.iter().enumerate() {
+            let Some(lane) = lane else {
+                continue;
+            };
+
+            if lane.block < lane.full_blocks {
+                let body = &blobs[lane.blob].as_ref()[SECRET_HASH_OFFSET..];
+                let chunk = &body[lane.block * 64..][..64];
+                for (word, bytes) in input.iter_mut().zip(chunk.chunks_exact(4)) {
+                    word[l] = u32::from_le_bytes(bytes.try_into().unwrap());
+                }
+            } else {
+                for (word, &tail) in input
+                    .iter_mut()
+                    .zip(&lane.tail[lane.block - lane.full_blocks])
+                {
+                    word[l] = tail;
+                }
+            }
+        }
+
+        transform_lanes(&mut state, &input);
+
+        for (l, lane) in lanes.iter_mut().enumerate() {
+            done[l] = false;
+            if let Some(lane) = lane {
+                lane.block += 1;
+                if lane.block == lane.blocks {
+                    finish(
+                        lane.blob,
+                        [state[0][l], state[1][l], state[2][l], state[3][l]],
+                    );
+                    done[l] = true;
+                }
+            }
+        }
+
+        for l in 0..L {
+            if done[l] {
+                fill(l, &mut lanes, &mut state, &mut pending, blobs);
+            }
+        }
+    }
+}
+
+#[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+#[target_feature(enable = "avx2")]
+unsafe fn digest_many_avx2<B: AsRef<[u8]>>(blobs: &[B], finish: impl FnMut(usize, [u32; 4])) {
+    digest_many_lanes::<8, B>(blobs, finish)
+}
+
+/// Compute the signature of each of `blobs` in parallel SIMD lanes: eight at a time with AVX2,
+/// and four at a time otherwise.
+fn digest_many<B: AsRef<[u8]>>(blobs: &[B], finish: impl FnMut(usize, [u32; 4])) {
+    #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+    if is_x86_feature_detected!("avx2") {
+        // SAFETY: AVX2 support was detected at runtime.
+        return unsafe { digest_many_avx2(blobs, finish) };
+    }
+
+    digest_many_lanes::<4, B>(blobs, finish)
+}
+
+/// Write each signature computed by `digest` into its blob.
+#[inline(always)]
+fn sign_with(
+    blobs: &mut [&mut [u8]],
+    digest: impl FnOnce(&[&mut [u8]], &mut dyn FnMut(usize, [u32; 4])),
+) {
+    for blob in blobs.iter() {
+        assert!(
+            blob.len() >= SECRET_HASH_OFFSET,
+            "blob is shorter than the DXBC header"
+        );
+    }
+
+    let mut signatures = vec![[0u32; 4]; blobs.len()];
+    digest(blobs, &mut |blob, signature| signatures[blob] = signature);
+
+    for (blob, signature) in blobs.iter_mut().zip(&signatures) {
+        blob[4..SECRET_HASH_OFFSET].copy_from_slice(bytemuck::cast_slice(signature));
+    }
+}
+
+/// Sign `blobs` in place, `L` at a time.
+#[cfg(test)]
+pub(crate) fn sign_many_lanes<const L: usize>(blobs: &mut [&mut [u8]]) {
+    sign_with(blobs, |blobs, finish| {
+        digest_many_lanes::<L, _>(blobs, finish)
+    })
+}
+
+/// Sign many DXIL blobs in place with Mach-Siegbert-Vogt DXCSA.
+///
+/// Independent blobs are hashed in parallel SIMD lanes: eight at a time with AVX2, and four at a
+/// time otherwise. The result is identical to calling [`sign_in_place`](crate::sign_in_place) on
+/// each blob.
+pub fn sign_many(blobs: &mut [&mut [u8]]) {
+    if let [blob] = blobs {
+        return crate::sign_in_place(blob);
+    }
+
+    sign_with(blobs, |blobs, finish| digest_many(blobs, finish))
+}
+
+/// Check the Mach-Siegbert-Vogt DXCSA signature of many DXIL blobs.
+///
+/// Like [`sign_many`], independent blobs are hashed in parallel SIMD lanes. The blobs are read in
+/// place and never copied. One result is returned per blob, identical to calling
+/// [`verify`](crate::verify) on it.
+pub fn verify_many<B: AsRef<[u8]>>(blobs: &[B]) -> Vec<bool> {
+    let mut valid = vec![false; blobs.len()];
+    digest_many(blobs, |blob, signature| {
+        valid[blob] = crate::signature_matches(blobs[blob].as_ref(), &signature)
+    });
+    valid
+}
@@ -0,0 +1,77 @@
+//! Incremental signing of a container that is produced in pieces.
+
+use crate::{termination_blocks, transform, Context, SECRET_HASH_OFFSET};
+
+/// An incremental Mach-Siegbert-Vogt DXCSA signer.
+///
+/// The container is fed in order through [`update`](Signer::update), in slices of any size,
+/// starting from its first byte. The `DXBC` magic and the 16-byte signature slot that follow are
+/// skipped, so the slot may hold a placeholder while the container is being written.
+/// [`finalize`](Signer::finalize) then returns the same signature as [`sign`](crate::sign) over
+/// the joined container, ready to be written back at bytes `4..20`.
+///
+/// Only one partial block is buffered, so a container can be signed as it is streamed to a file
+/// or socket without holding it in memory.
+#[derive(Clone)]
+pub struct Signer {
+    context: Context,
+    /// Header bytes left to skip before the signed body starts.
+    skip: usize,
+    /// Length of the signed body so far.
+    len: usize,
+}
+
+impl Signer {
+    /// Create a signer positioned at the start of a container.
+    pub fn new() -> Self {
+        Signer {
+            context: Context::new(),
+            skip: SECRET_HASH_OFFSET,
+            len: 0,
+        }
+    }
+
+    /// Feed the next bytes of the container.
+    pub fn update(&mut self, mut bytes: &[u8]) {
+        if self.skip > 0 {
+            let skipped = bytes.len().min(self.skip);
+            self.skip -= skipped;
+            bytes = &bytes[skipped..];
+        }
+
+        self.len += bytes.len();
+        self.context.update(bytes);
+    }
+
+    /// Finish the message and return the signature.
+    ///
+    /// # Panics
+    /// Panics if fewer bytes than the container header were fed.
+    pub fn finalize(mut self) -> [u32; 4] {
+        assert_eq!(self.skip, 0, "container is shorter than its header");
+
+        let (blocks, used) = termination_blocks(self.len, &self.context.input[..self.len & 0x3f]);
+        for block in &blocks[..used] {
+            transform(&mut self.context.buf, block);
+        }
+
+        self.context.buf
+    }
+}
+
+impl Default for Signer {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl std::io::Write for Signer {
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        self.update(buf);
+        Ok(buf.len())
+    }
+
+    fn flush(&mut self) -> std::io::Result<()> {
+        Ok(())
+    }
+}
@@ -1,4 +1,5 @@
 use std::env;
+use std::path::Path;
 
 fn main() {
     if env::var("DOCS_RS").is_ok() {
@@ -107,12 +108,26 @@ fn main() {
             "native/mesa/src/microsoft/compiler/dxil_nir_tess.c",
             "native/mesa/src/microsoft/compiler/dxil_nir.c",
             "native/mesa/src/microsoft/compiler/dxil_signature.c",
-            "native/mesa/src/microsoft/compiler/nir_to_dxil.c",
             "native/mesa/src/microsoft/spirv_to_dxil/dxil_spirv_nir_lower_bindless.c",
-            "native/mesa/src/microsoft/spirv_to_dxil/dxil_spirv_nir.c",
-            "native/mesa/src/microsoft/spirv_to_dxil/spirv_to_dxil.c",
         ]);
 
+    // With the `profile` feature, these are compiled through the wrappers in native/profile,
+    // which time the phases and NIR passes of a compile.
+    let profiled = [
+        "native/mesa/src/microsoft/compiler/nir_to_dxil.c",
+        "native/mesa/src/microsoft/spirv_to_dxil/dxil_spirv_nir.c",
+        "native/mesa/src/microsoft/spirv_to_dxil/spirv_to_dxil.c",
+    ];
+
+    if env::var_os("CARGO_FEATURE_PROFILE").is_some() {
+        for path in profiled {
+            let name = Path::new(path).file_name().unwrap();
+            build.file(Path::new("native/profile").join(name));
+        }
+    } else {
+        build.files(&profiled);
+    }
+
     let compile_paths = &[
         "native/mesa_mako",
         "native/mesa/src/compiler/nir",
@@ -143,6 +158,16 @@ fn main() {
             .define("UTIL_ARCH_LITTLE_ENDIAN", "1");
     };
 
+    if env::var_os("CARGO_FEATURE_ALLOCATOR").is_some() {
+        // Redirect malloc and friends in every Mesa translation unit to the hooks in src/alloc.
+        let hooks = "native/alloc_hooks.h";
+        if build.get_compiler().is_like_msvc() {
+            build.flag(&format!("/FI{hooks}"));
+        } else {
+            build.flag("-include").flag(hooks);
+        }
+    }
+
     for &path in compile_paths {
         for file in std::fs::read_dir(path).unwrap() {
             let file = file.unwrap();
@@ -0,0 +1,27 @@
+/*
+ * Force-included into every Mesa translation unit when Mesa's heap allocations are routed
+ * through Rust. The C library headers are included first so that their own declarations are not
+ * renamed, then malloc and friends are redirected to the hooks in src/alloc.
+ */
+#ifndef SPIRV_TO_DXIL_RS_ALLOC_HOOKS_H
+#define SPIRV_TO_DXIL_RS_ALLOC_HOOKS_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+void *spirv_to_dxil_rs_malloc(size_t size);
+void *spirv_to_dxil_rs_calloc(size_t count, size_t size);
+void *spirv_to_dxil_rs_realloc(void *ptr, size_t size);
+void spirv_to_dxil_rs_free(void *ptr);
+
+/* Object-like, so that free passed as a destructor callback is redirected too. */
+#define malloc spirv_to_dxil_rs_malloc
+#define calloc spirv_to_dxil_rs_calloc
+#define realloc spirv_to_dxil_rs_realloc
+#define free spirv_to_dxil_rs_free
+
+#endif
@@ -0,0 +1,4 @@
+/* dxil_spirv_nir.c with its NIR passes timed. See profile_hooks.h. */
+#include "../profile_hooks.h"
+
+#include "../mesa/src/microsoft/spirv_to_dxil/dxil_spirv_nir.c"
@@ -0,0 +1,12 @@
+/* nir_to_dxil.c with its NIR passes and container assembly timed. See profile_hooks.h. */
+#include "../profile_hooks.h"
+
+/* The container is assembled from dxil_container_init until it is written out. */
+#define dxil_container_init(...) \
+   (dxil_container_init(__VA_ARGS__), \
+    spirv_to_dxil_rs_phase_begin(SPIRV_TO_DXIL_RS_PHASE_CONTAINER))
+#define dxil_container_write(...) \
+   spirv_to_dxil_rs_phase_end_bool(SPIRV_TO_DXIL_RS_PHASE_CONTAINER, \
+                                   dxil_container_write(__VA_ARGS__))
+
+#include "../mesa/src/microsoft/compiler/nir_to_dxil.c"
@@ -0,0 +1,13 @@
+/* spirv_to_dxil.c with its parse, lowering and emission phases timed. See profile_hooks.h. */
+#include "../profile_hooks.h"
+
+#define spirv_to_nir(...) \
+   SPIRV_TO_DXIL_RS_TIME_PTR(SPIRV_TO_DXIL_RS_PHASE_PARSE, spirv_to_nir(__VA_ARGS__))
+#define dxil_spirv_nir_prep(...) \
+   SPIRV_TO_DXIL_RS_TIME_VOID(SPIRV_TO_DXIL_RS_PHASE_LOWER, dxil_spirv_nir_prep(__VA_ARGS__))
+#define dxil_spirv_nir_passes(...) \
+   SPIRV_TO_DXIL_RS_TIME_VOID(SPIRV_TO_DXIL_RS_PHASE_LOWER, dxil_spirv_nir_passes(__VA_ARGS__))
+#define nir_to_dxil(...) \
+   SPIRV_TO_DXIL_RS_TIME_BOOL(SPIRV_TO_DXIL_RS_PHASE_EMIT, nir_to_dxil(__VA_ARGS__))
+
+#include "../mesa/src/microsoft/spirv_to_dxil/spirv_to_dxil.c"
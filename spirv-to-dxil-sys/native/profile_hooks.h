@@ -0,0 +1,79 @@
+/*
+ * Included by the wrappers in native/profile, ahead of the Mesa source they compile, when the
+ * phases and NIR passes of a compile are timed. Mesa itself is not modified.
+ *
+ * The headers that declare the hooked functions are included first, so that the function-like
+ * macros each wrapper defines only rename calls, not declarations. NIR_PASS is redefined to
+ * report every pass to the hooks in src/profile.rs.
+ */
+#ifndef SPIRV_TO_DXIL_RS_PROFILE_HOOKS_H
+#define SPIRV_TO_DXIL_RS_PROFILE_HOOKS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nir.h"
+#include "spirv/nir_spirv.h"
+#include "dxil_container.h"
+#include "nir_to_dxil.h"
+#include "mesa/src/microsoft/spirv_to_dxil/dxil_spirv_nir.h"
+
+/* Must match the PHASE_ constants in src/profile.rs. */
+#define SPIRV_TO_DXIL_RS_PHASE_PARSE 0
+#define SPIRV_TO_DXIL_RS_PHASE_LOWER 1
+#define SPIRV_TO_DXIL_RS_PHASE_EMIT 2
+#define SPIRV_TO_DXIL_RS_PHASE_CONTAINER 3
+
+void spirv_to_dxil_rs_phase_begin(uint32_t phase);
+void spirv_to_dxil_rs_phase_end(uint32_t phase);
+void spirv_to_dxil_rs_pass_begin(const char *name);
+void spirv_to_dxil_rs_pass_end(const char *name, bool progress);
+
+static inline void *
+spirv_to_dxil_rs_phase_end_ptr(uint32_t phase, void *result)
+{
+   spirv_to_dxil_rs_phase_end(phase);
+   return result;
+}
+
+static inline bool
+spirv_to_dxil_rs_phase_end_bool(uint32_t phase, bool result)
+{
+   spirv_to_dxil_rs_phase_end(phase);
+   return result;
+}
+
+/* Time a call that returns a pointer or bool, or a void call. */
+#define SPIRV_TO_DXIL_RS_TIME_PTR(phase, call) \
+   spirv_to_dxil_rs_phase_end_ptr(phase, (spirv_to_dxil_rs_phase_begin(phase), (call)))
+#define SPIRV_TO_DXIL_RS_TIME_BOOL(phase, call) \
+   spirv_to_dxil_rs_phase_end_bool(phase, (spirv_to_dxil_rs_phase_begin(phase), (call)))
+#define SPIRV_TO_DXIL_RS_TIME_VOID(phase, call) \
+   (spirv_to_dxil_rs_phase_begin(phase), (call), spirv_to_dxil_rs_phase_end(phase))
+
+/* Same behavior as Mesa's NIR_PASS in a release build, plus the hooks. */
+#undef NIR_PASS
+#define NIR_PASS(progress, nir, pass, ...)                                    \
+   do {                                                                      \
+      spirv_to_dxil_rs_pass_begin(#pass);                                    \
+      bool spirv_to_dxil_rs_progress = pass(nir, ##__VA_ARGS__);             \
+      spirv_to_dxil_rs_pass_end(#pass, spirv_to_dxil_rs_progress);           \
+      if (spirv_to_dxil_rs_progress) {                                       \
+         UNUSED bool _;                                                      \
+         nir_validate_shader(nir, "after " #pass " in " __FILE__);          \
+         progress = true;                                                    \
+      }                                                                      \
+   } while (0)
+
+/* Passes run without NIR_PASS may return void, so their progress is not known. */
+#ifdef NIR_PASS_V
+#undef NIR_PASS_V
+#define NIR_PASS_V(nir, pass, ...)                                            \
+   do {                                                                      \
+      spirv_to_dxil_rs_pass_begin(#pass);                                    \
+      pass(nir, ##__VA_ARGS__);                                              \
+      spirv_to_dxil_rs_pass_end(#pass, false);                               \
+   } while (0)
+#endif
+
+#endif
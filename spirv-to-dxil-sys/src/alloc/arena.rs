@@ -0,0 +1,452 @@
+//! Per-thread bump arena for the allocations of a compile.
+//!
+//! Inside an [`ArenaScope`], small allocations are bump allocated from chunks owned by the
+//! current thread, so neither allocating nor freeing takes a lock. Chunks are aligned to their
+//! size, and every chunk is recorded in a lock-free registry, so `free` finds the chunk of an
+//! allocation by masking its address.
+//!
+//! Each chunk counts its live allocations. Allocations that outlive the compile, such as types
+//! interned in Mesa's process-wide `glsl_types` cache, keep their chunk alive until they are
+//! freed, from whichever thread.
+
+use super::{allocator, ALIGN, HEADER_SIZE};
+use std::alloc::Layout;
+use std::cell::Cell;
+use std::ffi::c_void;
+use std::marker::PhantomData;
+use std::sync::atomic::{fence, AtomicPtr, AtomicU64, AtomicUsize, Ordering};
+use std::sync::Mutex;
+
+/// Size and alignment of a chunk.
+const CHUNK_SIZE: usize = 1 << 20;
+/// Allocations larger than this go to the heap.
+const LARGE_ALLOCATION: usize = CHUNK_SIZE / 4;
+/// Space at the start of each chunk for its [`ChunkHeader`].
+const CHUNK_HEADER_SIZE: usize = 64;
+/// Free chunks kept for reuse by later compiles.
+const POOL_LIMIT: usize = 64;
+
+/// Address bits covered by the chunk registry. Chunks mapped above this are not used.
+const ADDRESS_BITS: u32 = if usize::BITS > 48 { 48 } else { usize::BITS };
+const CHUNK_BITS: u32 = CHUNK_SIZE.trailing_zeros();
+const INDEX_BITS: u32 = ADDRESS_BITS - CHUNK_BITS;
+const LEAF_BITS: u32 = if INDEX_BITS < 14 { INDEX_BITS } else { 14 };
+const ROOT_BITS: u32 = INDEX_BITS - LEAF_BITS;
+
+/// One bit per chunk-aligned address in a range of the address space.
+struct Leaf([AtomicU64; 1 << LEAF_BITS >> 6]);
+
+/// Two-level bitmap of the chunk-aligned addresses that are chunks. Leaves are allocated on
+/// first use and never freed.
+static REGISTRY: [AtomicPtr<Leaf>; 1 << ROOT_BITS] = {
+    const EMPTY: AtomicPtr<Leaf> = AtomicPtr::new(std::ptr::null_mut());
+    [EMPTY; 1 << ROOT_BITS]
+};
+
+/// Free chunks, shared by all threads.
+static POOL: Mutex<Vec<usize>> = Mutex::new(Vec::new());
+
+fn registry_slot(base: usize) -> Option<(&'static AtomicPtr<Leaf>, usize)> {
+    let index = base >> CHUNK_BITS;
+    if (index as u64) >> INDEX_BITS != 0 {
+        return None;
+    }
+
+    Some((
+        &REGISTRY[index >> LEAF_BITS],
+        index & ((1 << LEAF_BITS) - 1),
+    ))
+}
+
+fn is_chunk(base: usize) -> bool {
+    let Some((leaf, bit)) = registry_slot(base) else {
+        return false;
+    };
+
+    let leaf = leaf.load(Ordering::Acquire);
+    if leaf.is_null() {
+        return false;
+    }
+
+    // SAFETY: leaves are never freed.
+    let word = unsafe { &(*leaf).0[bit / 64] };
+    word.load(Ordering::Relaxed) & (1 << (bit % 64)) != 0
+}
+
+/// Add a chunk to the registry, failing if its address is not covered.
+fn register(base: usize) -> bool {
+    let Some((slot, bit)) = registry_slot(base) else {
+        return false;
+    };
+
+    let mut leaf = slot.load(Ordering::Acquire);
+    if leaf.is_null() {
+        const ZERO: AtomicU64 = AtomicU64::new(0);
+        let new = Box::into_raw(Box::new(Leaf([ZERO; 1 << LEAF_BITS >> 6])));
+        leaf = match slot.compare_exchange(
+            std::ptr::null_mut(),
+            new,
+            Ordering::AcqRel,
+            Ordering::Acquire,
+        ) {
+            Ok(_) => new,
+            Err(existing) => {
+                // SAFETY: the leaf was never published.
+                drop(unsafe { Box::from_raw(new) });
+                existing
+            }
+        };
+    }
+
+    // SAFETY: leaves are never freed.
+    unsafe { &(*leaf).0[bit / 64] }.fetch_or(1 << (bit % 64), Ordering::Relaxed);
+    true
+}
+
+fn unregister(base: usize) {
+    if let Some((slot, bit)) = registry_slot(base) {
+        let leaf = slot.load(Ordering::Acquire);
+        // SAFETY: the chunk was registered, so its leaf exists and is never freed.
+        unsafe { &(*leaf).0[bit / 64] }.fetch_and(!(1 << (bit % 64)), Ordering::Relaxed);
+    }
+}
+
+#[repr(C)]
+struct ChunkHeader {
+    /// Live allocations in the chunk, plus one while a thread is allocating from it.
+    live: AtomicUsize,
+}
+
+fn chunk_header(base: usize) -> &'static ChunkHeader {
+    // SAFETY: every chunk starts with an initialized header and is only freed once it is unused.
+    unsafe { &*(base as *const ChunkHeader) }
+}
+
+fn chunk_layout() -> Layout {
+    // SAFETY: the chunk size is a non-zero power of two.
+    unsafe { Layout::from_size_align_unchecked(CHUNK_SIZE, CHUNK_SIZE) }
+}
+
+/// Take a chunk from the pool or allocate a new one, with a reference held by the caller.
+fn acquire_chunk() -> Option<usize> {
+    let pooled = POOL.lock().ok().and_then(|mut pool| pool.pop());
+    let base = match pooled {
+        Some(base) => base,
+        None => {
+            // SAFETY: the layout has a non-zero size.
+            let base = unsafe { allocator().alloc(chunk_layout()) } as usize;
+            if base == 0 {
+                return None;
+            }
+
+            if !register(base) {
+                // SAFETY: allocated above with the same layout.
+                unsafe { allocator().dealloc(base as *mut u8, chunk_layout()) };
+                return None;
+            }
+
+            base
+        }
+    };
+
+    // SAFETY: the chunk is exclusively owned until it is handed out.
+    unsafe {
+        (base as *mut ChunkHeader).write(ChunkHeader {
+            live: AtomicUsize::new(1),
+        })
+    };
+    Some(base)
+}
+
+/// Drop a reference to a chunk, returning it to the pool once it is unused.
+fn release_chunk(base: usize) {
+    if chunk_header(base).live.fetch_sub(1, Ordering::Release) != 1 {
+        return;
+    }
+    fence(Ordering::Acquire);
+
+    if let Ok(mut pool) = POOL.lock() {
+        if pool.len() < POOL_LIMIT {
+            pool.push(base);
+            return;
+        }
+    }
+
+    unregister(base);
+    // SAFETY: the chunk is unused and was allocated with this layout.
+    unsafe { allocator().dealloc(base as *mut u8, chunk_layout()) };
+}
+
+/// Free the chunks kept in the pool for reuse.
+///
+/// Chunks that are still in use by a thread, or that hold allocations that outlived their
+/// compile, are not affected.
+pub fn trim() {
+    let chunks = match POOL.lock() {
+        Ok(mut pool) => std::mem::take(&mut *pool),
+        Err(_) => return,
+    };
+
+    for base in chunks {
+        unregister(base);
+        // SAFETY: pooled chunks are unused and were allocated with this layout.
+        unsafe { allocator().dealloc(base as *mut u8, chunk_layout()) };
+    }
+}
+
+struct ThreadArena {
+    /// Nesting depth of [`ArenaScope`]s on this thread.
+    depth: Cell<usize>,
+    /// The chunk being allocated from, or zero.
+    chunk: Cell<usize>,
+    /// The next free byte in the chunk.
+    cursor: Cell<usize>,
+}
+
+impl ThreadArena {
+    fn alloc(&self, size: usize) -> Option<*mut c_void> {
+        if self.depth.get() == 0 || size > LARGE_ALLOCATION {
+            return None;
+        }
+
+        let need = (HEADER_SIZE + size + ALIGN - 1) & !(ALIGN - 1);
+        let mut chunk = self.chunk.get();
+        if chunk == 0 || self.cursor.get() + need > chunk + CHUNK_SIZE {
+            let new = acquire_chunk()?;
+            if chunk != 0 {
+                release_chunk(chunk);
+            }
+
+            chunk = new;
+            self.chunk.set(chunk);
+            self.cursor.set(chunk + CHUNK_HEADER_SIZE);
+        }
+
+        let cursor = self.cursor.get();
+        self.cursor.set(cursor + need);
+        chunk_header(chunk).live.fetch_add(1, Ordering::Relaxed);
+
+        // SAFETY: the header lies within the chunk, before the allocation.
+        unsafe { (cursor as *mut usize).write(size) };
+        Some((cursor + HEADER_SIZE) as *mut c_void)
+    }
+
+    /// Grow the most recent allocation in place, if it is the last one in the current chunk.
+    fn grow(&self, ptr: usize, old_size: usize, new_size: usize) -> bool {
+        let chunk = self.chunk.get();
+        let end = ptr + ((old_size + ALIGN - 1) & !(ALIGN - 1));
+        let new_end = ptr + ((new_size + ALIGN - 1) & !(ALIGN - 1));
+        if self.depth.get() == 0
+            || chunk != ptr & !(CHUNK_SIZE - 1)
+            || self.cursor.get() != end
+            || new_end > chunk + CHUNK_SIZE
+        {
+            return false;
+        }
+
+        self.cursor.set(new_end);
+        // SAFETY: the header lies within the chunk, before the allocation.
+        unsafe { ((ptr - HEADER_SIZE) as *mut usize).write(new_size) };
+        true
+    }
+
+    /// Rewind the current chunk if every allocation made from it has been freed, or let go of
+    /// it otherwise.
+    fn reset(&self) {
+        let chunk = self.chunk.get();
+        if chunk == 0 {
+            return;
+        }
+
+        if chunk_header(chunk).live.load(Ordering::Acquire) == 1 {
+            self.cursor.set(chunk + CHUNK_HEADER_SIZE);
+        } else {
+            self.chunk.set(0);
+            release_chunk(chunk);
+        }
+    }
+}
+
+impl Drop for ThreadArena {
+    fn drop(&mut self) {
+        let chunk = self.chunk.get();
+        if chunk != 0 {
+            release_chunk(chunk);
+        }
+    }
+}
+
+thread_local! {
+    static ARENA: ThreadArena = const {
+        ThreadArena {
+            depth: Cell::new(0),
+            chunk: Cell::new(0),
+            cursor: Cell::new(0),
+        }
+    };
+}
+
+/// While alive, Mesa allocations made on the current thread are served from a bump arena.
+///
+/// Scopes may be nested. When the outermost scope on a thread ends, the arena is rewound if
+/// everything allocated in it has been freed, and kept for the next scope on the thread.
+pub struct ArenaScope {
+    _thread: PhantomData<*const ()>,
+}
+
+impl ArenaScope {
+    /// Start serving allocations on the current thread from the arena.
+    pub fn enter() -> Self {
+        let _ = ARENA.try_with(|arena| arena.depth.set(arena.depth.get() + 1));
+        ArenaScope {
+            _thread: PhantomData,
+        }
+    }
+}
+
+impl Drop for ArenaScope {
+    fn drop(&mut self) {
+        let _ = ARENA.try_with(|arena| {
+            let depth = arena.depth.get() - 1;
+            arena.depth.set(depth);
+            if depth == 0 {
+                arena.reset();
+            }
+        });
+    }
+}
+
+/// Allocate from the arena of the current thread, if it is inside an [`ArenaScope`].
+pub(super) fn alloc(size: usize) -> Option<*mut c_void> {
+    ARENA.try_with(|arena| arena.alloc(size)).ok().flatten()
+}
+
+/// Whether `ptr` was allocated from an arena.
+pub(super) fn owns(ptr: *mut c_void) -> bool {
+    is_chunk(ptr as usize & !(CHUNK_SIZE - 1))
+}
+
+/// Reallocate an arena allocation, growing it in place if it is the last one in its chunk.
+///
+/// # Safety
+/// `ptr` must be a live allocation for which [`owns`] returned true.
+pub(super) unsafe fn realloc(ptr: *mut c_void, size: usize) -> *mut c_void {
+    let old_size = ((ptr as usize - HEADER_SIZE) as *const usize).read();
+    if size <= old_size {
+        ((ptr as usize - HEADER_SIZE) as *mut usize).write(size);
+        return ptr;
+    }
+
+    if ARENA
+        .try_with(|arena| arena.grow(ptr as usize, old_size, size))
+        .unwrap_or(false)
+    {
+        return ptr;
+    }
+
+    let new = super::allocate(size, false);
+    if !new.is_null() {
+        std::ptr::copy_nonoverlapping(ptr.cast::<u8>(), new.cast::<u8>(), old_size);
+        free(ptr);
+    }
+    new
+}
+
+/// Free an arena allocation.
+///
+/// # Safety
+/// `ptr` must be a live allocation for which [`owns`] returned true.
+pub(super) unsafe fn free(ptr: *mut c_void) {
+    release_chunk(ptr as usize & !(CHUNK_SIZE - 1));
+}
+
+#[cfg(test)]
+mod tests {
+    use super::super::{spirv_to_dxil_rs_calloc, spirv_to_dxil_rs_free};
+    use super::super::{spirv_to_dxil_rs_malloc, spirv_to_dxil_rs_realloc};
+    use super::*;
+
+    fn fill(ptr: *mut c_void, len: usize, value: u8) {
+        unsafe { ptr.cast::<u8>().write_bytes(value, len) };
+    }
+
+    fn check(ptr: *mut c_void, len: usize, value: u8) {
+        let bytes = unsafe { std::slice::from_raw_parts(ptr.cast::<u8>(), len) };
+        assert!(bytes.iter().all(|&b| b == value));
+    }
+
+    #[test]
+    fn test_arena_allocations() {
+        unsafe {
+            let outside = spirv_to_dxil_rs_malloc(32);
+            assert!(!is_chunk(outside as usize & !(CHUNK_SIZE - 1)));
+
+            let scope = ArenaScope::enter();
+
+            let small = spirv_to_dxil_rs_malloc(24);
+            assert!(is_chunk(small as usize & !(CHUNK_SIZE - 1)));
+            assert_eq!(small as usize % ALIGN, 0);
+            fill(small, 24, 0xab);
+
+            let zeroed = spirv_to_dxil_rs_calloc(8, 16);
+            check(zeroed, 128, 0);
+
+            let large = spirv_to_dxil_rs_malloc(LARGE_ALLOCATION + 1);
+            assert!(!is_chunk(large as usize & !(CHUNK_SIZE - 1)));
+
+            // Reallocating anything but the last allocation moves it.
+            let moved = spirv_to_dxil_rs_realloc(small, 4096);
+            assert_ne!(moved, small);
+            check(moved, 24, 0xab);
+
+            // The last allocation grows in place.
+            let grown = spirv_to_dxil_rs_realloc(moved, 8192);
+            assert_eq!(grown, moved);
+
+            let zeroed_large = spirv_to_dxil_rs_realloc(zeroed, LARGE_ALLOCATION * 2);
+            assert!(!is_chunk(zeroed_large as usize & !(CHUNK_SIZE - 1)));
+            check(zeroed_large, 128, 0);
+
+            // Allocations from outside the arena are still freed by the heap.
+            spirv_to_dxil_rs_free(outside);
+            spirv_to_dxil_rs_free(large);
+            spirv_to_dxil_rs_free(grown);
+            spirv_to_dxil_rs_free(zeroed_large);
+
+            let chunk = ARENA.with(|arena| arena.chunk.get());
+            drop(scope);
+
+            // Everything was freed, so the chunk is kept and rewound.
+            ARENA.with(|arena| {
+                assert_eq!(arena.chunk.get(), chunk);
+                assert_eq!(arena.cursor.get(), chunk + CHUNK_HEADER_SIZE);
+            });
+        }
+    }
+
+    #[test]
+    fn test_arena_outlives_scope() {
+        let ptr = std::thread::spawn(|| unsafe {
+            let _scope = ArenaScope::enter();
+
+            // Fill more than one chunk.
+            let ptrs: Vec<usize> = (0..CHUNK_SIZE / 1024 * 3)
+                .map(|_| spirv_to_dxil_rs_malloc(1000) as usize)
+                .collect();
+
+            for &ptr in &ptrs[1..] {
+                spirv_to_dxil_rs_free(ptr as *mut c_void);
+            }
+
+            fill(ptrs[0] as *mut c_void, 1000, 0xcd);
+            ptrs[0]
+        })
+        .join()
+        .unwrap();
+
+        // The allocation is still valid after its thread and scope are gone, and can be freed
+        // from another thread.
+        check(ptr as *mut c_void, 1000, 0xcd);
+        unsafe { spirv_to_dxil_rs_free(ptr as *mut c_void) };
+    }
+}
@@ -0,0 +1,427 @@
+//! Heap allocation hooks for Mesa.
+//!
+//! With the `allocator` feature, Mesa is compiled with `malloc`, `calloc`, `realloc` and `free`
+//! redirected to the hooks in this module by `native/alloc_hooks.h`, so the native compiler
+//! allocates from the same allocator as the rest of the process instead of always using the C
+//! library heap.
+//!
+//! By default the hooks allocate from the Rust global allocator, so a `#[global_allocator]`
+//! chosen by the application applies to Mesa as well. A different allocator can be installed
+//! with [`set_allocator`] before the first compile.
+//!
+//! Each allocation is preceded by a small header recording its size, which the Rust allocator
+//! interface needs to free it. Memory that the C library allocated for Mesa itself, such as by
+//! `strdup`, has no such header and is handed back to the C library.
+//!
+//! Allocations made inside a [`MemoryScope`] are counted, and can be capped.
+//!
+//! With the `arena` feature, allocations made inside an [`ArenaScope`] are served from a
+//! per-thread bump arena instead.
+
+#[cfg(feature = "arena")]
+mod arena;
+
+#[cfg(feature = "arena")]
+pub use arena::{trim, ArenaScope};
+
+use std::alloc::{GlobalAlloc, Layout};
+use std::cell::Cell;
+use std::ffi::c_void;
+use std::marker::PhantomData;
+use std::sync::OnceLock;
+
+mod libc {
+    use std::ffi::c_void;
+
+    extern "C" {
+        pub fn realloc(ptr: *mut c_void, size: usize) -> *mut c_void;
+        pub fn free(ptr: *mut c_void);
+    }
+}
+
+/// Alignment of every allocation, matching `max_align_t`.
+const ALIGN: usize = 16;
+/// Space before each allocation that records its size.
+const HEADER_SIZE: usize = ALIGN;
+/// Marks an allocation from the heap, to tell it apart from memory the C library allocated.
+///
+/// Stored in the last 8 bytes of the header, directly in front of the allocation, whatever the
+/// width of `usize`.
+const HEAP_MAGIC: u64 = 0x5332_4458_4845_4150;
+const HEAP_MAGIC_OFFSET: usize = HEADER_SIZE - std::mem::size_of::<u64>();
+
+/// Forwards to the Rust global allocator.
+struct RustAllocator;
+
+unsafe impl GlobalAlloc for RustAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        std::alloc::alloc(layout)
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        std::alloc::alloc_zeroed(layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        std::alloc::realloc(ptr, layout, new_size)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        std::alloc::dealloc(ptr, layout)
+    }
+}
+
+static ALLOCATOR: OnceLock<&'static (dyn GlobalAlloc + Sync)> = OnceLock::new();
+
+fn allocator() -> &'static dyn GlobalAlloc {
+    *ALLOCATOR.get_or_init(|| &RustAllocator)
+}
+
+/// Install the allocator that Mesa allocates from.
+///
+/// The allocator can only be chosen once, before Mesa makes its first allocation, since memory
+/// must be freed by the allocator it came from. If an allocator was already installed or used,
+/// `allocator` is returned as the error.
+pub fn set_allocator(
+    allocator: &'static (dyn GlobalAlloc + Sync),
+) -> Result<(), &'static (dyn GlobalAlloc + Sync)> {
+    ALLOCATOR.set(allocator)
+}
+
+/// Allocation totals of a [`MemoryScope`].
+#[derive(Debug, Default, Copy, Clone, PartialEq, Eq)]
+pub struct MemoryUsage {
+    /// The most bytes that were allocated at once during the scope, not counting memory that was
+    /// allocated before it.
+    pub peak_bytes: usize,
+    /// The number of allocations made during the scope, including reallocations.
+    pub allocations: usize,
+}
+
+#[derive(Copy, Clone)]
+struct Tracker {
+    /// Bytes allocated since the scope was entered, less the bytes freed.
+    current: isize,
+    usage: MemoryUsage,
+}
+
+thread_local! {
+    static TRACKER: Cell<Option<Tracker>> = const { Cell::new(None) };
+}
+
+/// While alive, Mesa allocations made on the current thread are counted.
+///
+/// Counting never fails an allocation, since most of Mesa does not check for a null pointer.
+/// Scopes may be nested, in which case only the innermost scope counts allocations.
+pub struct MemoryScope {
+    previous: Option<Tracker>,
+    _thread: PhantomData<*const ()>,
+}
+
+impl MemoryScope {
+    /// Start counting allocations on the current thread.
+    pub fn enter() -> Self {
+        let tracker = Tracker {
+            current: 0,
+            usage: MemoryUsage::default(),
+        };
+
+        MemoryScope {
+            previous: TRACKER
+                .try_with(|cell| cell.replace(Some(tracker)))
+                .ok()
+                .flatten(),
+            _thread: PhantomData,
+        }
+    }
+
+    /// The allocations counted so far.
+    pub fn usage(&self) -> MemoryUsage {
+        TRACKER
+            .try_with(|cell| cell.get().map(|tracker| tracker.usage))
+            .ok()
+            .flatten()
+            .unwrap_or_default()
+    }
+
+    /// Stop counting and return the totals.
+    pub fn finish(self) -> MemoryUsage {
+        self.usage()
+    }
+}
+
+impl Drop for MemoryScope {
+    fn drop(&mut self) {
+        let _ = TRACKER.try_with(|cell| cell.set(self.previous));
+    }
+}
+
+/// Count an allocation of `size` bytes.
+fn charge(size: usize) {
+    let _ = TRACKER.try_with(|cell| {
+        if let Some(mut tracker) = cell.get() {
+            tracker.current = tracker.current.saturating_add_unsigned(size);
+            tracker.usage.allocations += 1;
+            if tracker.current > 0 {
+                tracker.usage.peak_bytes = tracker.usage.peak_bytes.max(tracker.current as usize);
+            }
+            cell.set(Some(tracker));
+        }
+    });
+}
+
+/// Count `size` bytes as freed.
+fn refund(size: usize) {
+    let _ = TRACKER.try_with(|cell| {
+        if let Some(mut tracker) = cell.get() {
+            tracker.current = tracker.current.saturating_sub_unsigned(size);
+            cell.set(Some(tracker));
+        }
+    });
+}
+
+/// The size requested for an allocation from the heap or an arena.
+///
+/// # Safety
+/// `ptr` must be a live allocation from the heap or an arena, both of which record the size in
+/// front of it.
+unsafe fn allocation_size(ptr: *mut c_void) -> usize {
+    ((ptr as usize - HEADER_SIZE) as *const usize).read()
+}
+
+fn heap_layout(size: usize) -> Option<Layout> {
+    Layout::from_size_align(size.checked_add(HEADER_SIZE)?, ALIGN).ok()
+}
+
+/// Whether `ptr` was allocated by [`heap_alloc`].
+///
+/// # Safety
+/// `ptr` must be a live allocation from either the heap or the C library, both of which keep
+/// their own bookkeeping in front of every allocation.
+unsafe fn is_heap(ptr: *mut c_void) -> bool {
+    ((ptr as usize - HEADER_SIZE + HEAP_MAGIC_OFFSET) as *const u64).read() == HEAP_MAGIC
+}
+
+unsafe fn heap_alloc(size: usize, zeroed: bool) -> *mut c_void {
+    let Some(layout) = heap_layout(size) else {
+        return std::ptr::null_mut();
+    };
+
+    let base = if zeroed {
+        allocator().alloc_zeroed(layout)
+    } else {
+        allocator().alloc(layout)
+    };
+    if base.is_null() {
+        return std::ptr::null_mut();
+    }
+
+    base.cast::<usize>().write(size);
+    base.add(HEAP_MAGIC_OFFSET).cast::<u64>().write(HEAP_MAGIC);
+    base.add(HEADER_SIZE).cast()
+}
+
+unsafe fn heap_realloc(ptr: *mut c_void, size: usize) -> *mut c_void {
+    let base = ptr.cast::<u8>().sub(HEADER_SIZE);
+    let old_size = base.cast::<usize>().read();
+    let Some(layout) = heap_layout(size) else {
+        return std::ptr::null_mut();
+    };
+
+    // SAFETY: the layout was valid when the allocation was made.
+    let old_layout = Layout::from_size_align_unchecked(old_size + HEADER_SIZE, ALIGN);
+    let base = allocator().realloc(base, old_layout, layout.size());
+    if base.is_null() {
+        return std::ptr::null_mut();
+    }
+
+    base.cast::<usize>().write(size);
+    base.add(HEADER_SIZE).cast()
+}
+
+unsafe fn heap_free(ptr: *mut c_void) {
+    let base = ptr.cast::<u8>().sub(HEADER_SIZE);
+    let size = base.cast::<usize>().read();
+    // Clear the magic so that a stale pointer is not mistaken for a heap allocation.
+    base.add(HEAP_MAGIC_OFFSET).cast::<u64>().write(0);
+    allocator().dealloc(
+        base,
+        Layout::from_size_align_unchecked(size + HEADER_SIZE, ALIGN),
+    );
+}
+
+unsafe fn allocate(size: usize, zeroed: bool) -> *mut c_void {
+    #[cfg(feature = "arena")]
+    if let Some(ptr) = arena::alloc(size) {
+        if zeroed {
+            // Pooled chunks are reused without being cleared.
+            ptr.cast::<u8>().write_bytes(0, size);
+        }
+        return ptr;
+    }
+
+    heap_alloc(size, zeroed)
+}
+
+#[no_mangle]
+unsafe extern "C" fn spirv_to_dxil_rs_malloc(size: usize) -> *mut c_void {
+    charge(size);
+
+    let ptr = allocate(size, false);
+    if ptr.is_null() {
+        refund(size);
+    }
+    ptr
+}
+
+#[no_mangle]
+unsafe extern "C" fn spirv_to_dxil_rs_calloc(count: usize, size: usize) -> *mut c_void {
+    let Some(total) = count.checked_mul(size) else {
+        return std::ptr::null_mut();
+    };
+
+    charge(total);
+
+    let ptr = allocate(total, true);
+    if ptr.is_null() {
+        refund(total);
+    }
+    ptr
+}
+
+#[no_mangle]
+unsafe extern "C" fn spirv_to_dxil_rs_realloc(ptr: *mut c_void, size: usize) -> *mut c_void {
+    if ptr.is_null() {
+        return spirv_to_dxil_rs_malloc(size);
+    }
+
+    #[cfg(feature = "arena")]
+    let owned = arena::owns(ptr) || is_heap(ptr);
+    #[cfg(not(feature = "arena"))]
+    let owned = is_heap(ptr);
+
+    if !owned {
+        return libc::realloc(ptr, size);
+    }
+
+    let old_size = allocation_size(ptr);
+    let growth = size.saturating_sub(old_size);
+    charge(growth);
+
+    #[cfg(feature = "arena")]
+    let new = if arena::owns(ptr) {
+        arena::realloc(ptr, size)
+    } else {
+        heap_realloc(ptr, size)
+    };
+    #[cfg(not(feature = "arena"))]
+    let new = heap_realloc(ptr, size);
+
+    refund(if new.is_null() {
+        growth
+    } else {
+        old_size.saturating_sub(size)
+    });
+    new
+}
+
+#[no_mangle]
+unsafe extern "C" fn spirv_to_dxil_rs_free(ptr: *mut c_void) {
+    if ptr.is_null() {
+        return;
+    }
+
+    #[cfg(feature = "arena")]
+    if arena::owns(ptr) {
+        refund(allocation_size(ptr));
+        return arena::free(ptr);
+    }
+
+    if is_heap(ptr) {
+        refund(allocation_size(ptr));
+        heap_free(ptr);
+    } else {
+        libc::free(ptr);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    extern "C" {
+        fn strdup(s: *const std::ffi::c_char) -> *mut std::ffi::c_char;
+    }
+
+    #[test]
+    fn test_heap_allocations() {
+        unsafe {
+            let ptr = spirv_to_dxil_rs_calloc(4, 8);
+            assert!(is_heap(ptr));
+            assert_eq!(ptr as usize % ALIGN, 0);
+            assert!(std::slice::from_raw_parts(ptr.cast::<u8>(), 32)
+                .iter()
+                .all(|&b| b == 0));
+
+            ptr.cast::<u8>().write_bytes(0xab, 32);
+            let ptr = spirv_to_dxil_rs_realloc(ptr, 4096);
+            assert!(std::slice::from_raw_parts(ptr.cast::<u8>(), 32)
+                .iter()
+                .all(|&b| b == 0xab));
+            spirv_to_dxil_rs_free(ptr);
+
+            // Memory the C library allocated is handed back to it.
+            let foreign = strdup(c"spirv-to-dxil".as_ptr()).cast::<c_void>();
+            assert!(!is_heap(foreign));
+            let foreign = spirv_to_dxil_rs_realloc(foreign, 64);
+            spirv_to_dxil_rs_free(foreign);
+
+            assert!(spirv_to_dxil_rs_malloc(usize::MAX - 8).is_null());
+        }
+    }
+
+    #[test]
+    fn test_heap_header() {
+        unsafe {
+            for size in [0, 1, 24, 4096] {
+                for zeroed in [false, true] {
+                    let ptr = heap_alloc(size, zeroed);
+                    assert!(is_heap(ptr));
+                    assert_eq!(allocation_size(ptr), size);
+                    heap_free(ptr);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_memory_scope() {
+        unsafe {
+            let before = spirv_to_dxil_rs_malloc(1000);
+
+            let scope = MemoryScope::enter();
+            let a = spirv_to_dxil_rs_malloc(1024);
+            let b = spirv_to_dxil_rs_calloc(2, 1024);
+            spirv_to_dxil_rs_free(a);
+            let b = spirv_to_dxil_rs_realloc(b, 3072);
+            assert!(!b.is_null());
+
+            // Memory from before the scope does not count against it.
+            spirv_to_dxil_rs_free(before);
+
+            let usage = scope.usage();
+            assert_eq!(usage.peak_bytes, 3072);
+            assert_eq!(usage.allocations, 3);
+
+            let nested = MemoryScope::enter();
+            let c = spirv_to_dxil_rs_malloc(8192);
+            assert_eq!(nested.finish().peak_bytes, 8192);
+
+            // Allocations in the nested scope are not counted by the outer one.
+            assert_eq!(scope.finish(), usage);
+
+            spirv_to_dxil_rs_free(b);
+            spirv_to_dxil_rs_free(c);
+        }
+    }
+}
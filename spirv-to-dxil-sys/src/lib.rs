@@ -2,12 +2,25 @@
 #![allow(non_camel_case_types)]
 #![allow(non_snake_case)]
 
+#[cfg(feature = "allocator")]
+pub mod alloc;
 mod bindings;
 mod native;
+#[cfg(feature = "profile")]
+pub mod profile;
 
 pub use bindings::*;
 use bytemuck::NoUninit;
 
+// Mesa functions that are not declared by spirv_to_dxil.h.
+extern "C" {
+    /// Take a reference to Mesa's process-wide `glsl_types` cache, creating it on first use.
+    pub fn glsl_type_singleton_init_or_ref();
+    /// Drop a reference to the `glsl_types` cache. The cache and every type interned in it are
+    /// freed when the last reference is dropped.
+    pub fn glsl_type_singleton_decref();
+}
+
 impl Default for dxil_spirv_yz_flip_mode {
     fn default() -> Self {
         dxil_spirv_yz_flip_mode::YZ_FLIP_NONE
@@ -0,0 +1,307 @@
+//! Timing hooks for the phases and NIR passes of a compile.
+//!
+//! With the `profile` feature, `spirv_to_dxil.c`, `dxil_spirv_nir.c` and `nir_to_dxil.c` are
+//! compiled through the wrappers in `native/profile`, which include `native/profile_hooks.h`
+//! ahead of the unmodified Mesa source. The calls that start each phase of a compile, and Mesa's
+//! `NIR_PASS` macro, report to the hooks in this module, and a [`ProfileScope`] collects what
+//! they report on the current thread.
+
+use std::cell::RefCell;
+use std::collections::HashMap;
+use std::ffi::{c_char, CStr};
+use std::marker::PhantomData;
+use std::time::{Duration, Instant};
+
+// Must match the SPIRV_TO_DXIL_RS_PHASE_ defines in native/profile_hooks.h.
+const PHASE_PARSE: u32 = 0;
+const PHASE_LOWER: u32 = 1;
+const PHASE_EMIT: u32 = 2;
+const PHASE_CONTAINER: u32 = 3;
+const PHASES: usize = 4;
+
+/// How often a NIR pass ran during a [`ProfileScope`], and for how long.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct PassProfile {
+    /// The name of the function that implements the pass, such as `nir_opt_algebraic`.
+    pub name: &'static str,
+    /// The number of times the pass ran.
+    pub invocations: usize,
+    /// The number of times the pass reported that it changed the shader.
+    ///
+    /// Passes that Mesa runs with `NIR_PASS_V` never report progress.
+    pub progress: usize,
+    /// The total time spent in the pass, including any passes it ran itself.
+    pub time: Duration,
+}
+
+/// Time spent in each phase of a compile, and in each NIR pass, collected by a [`ProfileScope`].
+///
+/// Time spent in NIR optimization passes is reported as `optimize`, and is not counted towards
+/// the phase that ran them.
+#[derive(Debug, Default, Clone, PartialEq, Eq)]
+pub struct Profile {
+    /// Translating SPIR-V to NIR in `spirv_to_nir`.
+    pub parse: Duration,
+    /// The lowering passes of `dxil_spirv_nir_prep` and `dxil_spirv_nir_passes`.
+    pub lower: Duration,
+    /// NIR optimization passes, the `nir_opt_*` passes and `nir_copy_prop`, in either
+    /// `dxil_spirv_nir_passes` or `nir_to_dxil`.
+    pub optimize: Duration,
+    /// Emitting DXIL in `nir_to_dxil`.
+    pub emit: Duration,
+    /// Assembling the DXBC container at the end of `nir_to_dxil`.
+    pub container: Duration,
+    /// Every NIR pass that ran, in the order each first ran.
+    ///
+    /// Only passes run by `spirv_to_dxil.c`, `dxil_spirv_nir.c` and `nir_to_dxil.c` are listed,
+    /// not the passes that other passes run internally.
+    pub passes: Vec<PassProfile>,
+}
+
+/// Whether a NIR pass only optimizes, rather than lowers.
+fn is_optimization(pass: &str) -> bool {
+    pass.starts_with("nir_opt_") || pass == "nir_copy_prop"
+}
+
+#[derive(Default)]
+struct Profiler {
+    /// When each phase that is running started.
+    phase_starts: [Option<Instant>; PHASES],
+    phase_totals: [Duration; PHASES],
+    /// Time spent in optimization passes while each phase was running.
+    phase_optimize: [Duration; PHASES],
+    optimize: Duration,
+    /// The passes that are running, innermost last, and whether each one is an optimization.
+    running: Vec<(Instant, bool)>,
+    passes: Vec<PassProfile>,
+    /// The index of each pass in `passes`.
+    pass_indices: HashMap<&'static str, usize>,
+}
+
+impl Profiler {
+    fn record_pass(&mut self, name: &'static str, progress: bool, time: Duration) {
+        let index = *self.pass_indices.entry(name).or_insert_with(|| {
+            self.passes.push(PassProfile {
+                name,
+                invocations: 0,
+                progress: 0,
+                time: Duration::ZERO,
+            });
+            self.passes.len() - 1
+        });
+
+        let pass = &mut self.passes[index];
+        pass.invocations += 1;
+        pass.progress += progress as usize;
+        pass.time += time;
+    }
+
+    fn profile(self) -> Profile {
+        let total = |phase: u32| self.phase_totals[phase as usize];
+        let optimize = |phase: u32| self.phase_optimize[phase as usize];
+
+        Profile {
+            parse: total(PHASE_PARSE).saturating_sub(optimize(PHASE_PARSE)),
+            lower: total(PHASE_LOWER).saturating_sub(optimize(PHASE_LOWER)),
+            optimize: self.optimize,
+            emit: total(PHASE_EMIT)
+                .saturating_sub(total(PHASE_CONTAINER))
+                .saturating_sub(optimize(PHASE_EMIT)),
+            container: total(PHASE_CONTAINER),
+            passes: self.passes,
+        }
+    }
+}
+
+thread_local! {
+    static PROFILER: RefCell<Option<Profiler>> = const { RefCell::new(None) };
+}
+
+/// Run `f` on the profiler of the current thread, if a [`ProfileScope`] is active.
+fn with_profiler(f: impl FnOnce(&mut Profiler)) {
+    let _ = PROFILER.try_with(|cell| {
+        if let Some(profiler) = cell.borrow_mut().as_mut() {
+            f(profiler);
+        }
+    });
+}
+
+/// While alive, the phases and NIR passes of compiles on the current thread are timed.
+///
+/// Scopes may be nested, in which case only the innermost scope is timed.
+pub struct ProfileScope {
+    previous: Option<Profiler>,
+    _thread: PhantomData<*const ()>,
+}
+
+impl ProfileScope {
+    /// Start timing compiles on the current thread.
+    pub fn enter() -> Self {
+        ProfileScope {
+            previous: PROFILER
+                .try_with(|cell| cell.replace(Some(Profiler::default())))
+                .ok()
+                .flatten(),
+            _thread: PhantomData,
+        }
+    }
+
+    /// Stop timing and return the profile.
+    pub fn finish(self) -> Profile {
+        PROFILER
+            .try_with(|cell| cell.borrow_mut().take().map(Profiler::profile))
+            .ok()
+            .flatten()
+            .unwrap_or_default()
+    }
+}
+
+impl Drop for ProfileScope {
+    fn drop(&mut self) {
+        let _ = PROFILER.try_with(|cell| cell.replace(self.previous.take()));
+    }
+}
+
+#[no_mangle]
+extern "C" fn spirv_to_dxil_rs_phase_begin(phase: u32) {
+    with_profiler(|profiler| {
+        if let Some(start) = profiler.phase_starts.get_mut(phase as usize) {
+            *start = Some(Instant::now());
+        }
+    });
+}
+
+#[no_mangle]
+extern "C" fn spirv_to_dxil_rs_phase_end(phase: u32) {
+    with_profiler(|profiler| {
+        let Some(start) = profiler
+            .phase_starts
+            .get_mut(phase as usize)
+            .and_then(Option::take)
+        else {
+            return;
+        };
+        profiler.phase_totals[phase as usize] += start.elapsed();
+    });
+}
+
+/// The name of a pass, as stringified by `NIR_PASS`.
+///
+/// # Safety
+/// `name` must be a string literal, which lives for the rest of the process.
+unsafe fn pass_name(name: *const c_char) -> &'static str {
+    unsafe { CStr::from_ptr(name) }
+        .to_str()
+        .unwrap_or("<invalid>")
+}
+
+#[no_mangle]
+unsafe extern "C" fn spirv_to_dxil_rs_pass_begin(name: *const c_char) {
+    with_profiler(|profiler| {
+        let optimization = is_optimization(unsafe { pass_name(name) });
+        profiler.running.push((Instant::now(), optimization));
+    });
+}
+
+#[no_mangle]
+unsafe extern "C" fn spirv_to_dxil_rs_pass_end(name: *const c_char, progress: bool) {
+    with_profiler(|profiler| {
+        let Some((start, optimization)) = profiler.running.pop() else {
+            return;
+        };
+
+        let elapsed = start.elapsed();
+        profiler.record_pass(unsafe { pass_name(name) }, progress, elapsed);
+
+        // Optimizations run by another optimization are already counted by the outer one.
+        let nested = profiler.running.iter().any(|&(_, outer)| outer);
+        if !optimization || nested {
+            return;
+        }
+
+        profiler.optimize += elapsed;
+        for (phase, phase_start) in profiler.phase_starts.iter().enumerate() {
+            if phase_start.is_some() {
+                profiler.phase_optimize[phase] += elapsed;
+            }
+        }
+    });
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::thread::sleep;
+
+    fn pass(name: &'static CStr, duration: Duration) {
+        unsafe {
+            spirv_to_dxil_rs_pass_begin(name.as_ptr());
+            sleep(duration);
+            spirv_to_dxil_rs_pass_end(name.as_ptr(), true);
+        }
+    }
+
+    #[test]
+    fn test_profile_scope() {
+        let millis = Duration::from_millis;
+
+        // Nothing is collected outside of a scope.
+        spirv_to_dxil_rs_phase_begin(PHASE_PARSE);
+        spirv_to_dxil_rs_phase_end(PHASE_PARSE);
+
+        let scope = ProfileScope::enter();
+
+        spirv_to_dxil_rs_phase_begin(PHASE_PARSE);
+        sleep(millis(2));
+        spirv_to_dxil_rs_phase_end(PHASE_PARSE);
+
+        spirv_to_dxil_rs_phase_begin(PHASE_LOWER);
+        pass(c"nir_lower_io", millis(2));
+        pass(c"nir_opt_dce", millis(4));
+        spirv_to_dxil_rs_phase_end(PHASE_LOWER);
+
+        spirv_to_dxil_rs_phase_begin(PHASE_EMIT);
+        pass(c"nir_copy_prop", millis(4));
+        pass(c"nir_opt_dce", millis(1));
+        spirv_to_dxil_rs_phase_begin(PHASE_CONTAINER);
+        sleep(millis(2));
+        spirv_to_dxil_rs_phase_end(PHASE_CONTAINER);
+        spirv_to_dxil_rs_phase_end(PHASE_EMIT);
+
+        let nested = ProfileScope::enter();
+        spirv_to_dxil_rs_phase_begin(PHASE_PARSE);
+        spirv_to_dxil_rs_phase_end(PHASE_PARSE);
+        assert!(nested.finish().lower.is_zero());
+
+        // Only lower bounds hold for wall-clock time, since sleeps can overrun.
+        let profile = scope.finish();
+        assert!(profile.parse >= millis(2));
+        assert!(profile.lower >= millis(2));
+        assert!(profile.container >= millis(2));
+
+        // Optimizations are counted once, in optimize, whichever phase ran them.
+        let optimizations: Duration = profile
+            .passes
+            .iter()
+            .filter(|pass| is_optimization(pass.name))
+            .map(|pass| pass.time)
+            .sum();
+        assert_eq!(profile.optimize, optimizations);
+        assert!(profile.optimize >= millis(9));
+
+        let passes: Vec<_> = profile
+            .passes
+            .iter()
+            .map(|pass| (pass.name, pass.invocations, pass.progress))
+            .collect();
+        assert_eq!(
+            passes,
+            [
+                ("nir_lower_io", 1, 1),
+                ("nir_opt_dce", 2, 2),
+                ("nir_copy_prop", 1, 1)
+            ]
+        );
+        assert!(profile.passes[1].time >= millis(5));
+    }
+}
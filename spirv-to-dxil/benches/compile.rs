@@ -0,0 +1,135 @@
+mod corpus;
+
+use corpus::Shader;
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use spirv_to_dxil::{RuntimeConfig, ValidatorVersion};
+
+fn compile(shader: &Shader) -> spirv_to_dxil::DxilObject {
+    let specializations = (!shader.specializations.is_empty()).then_some(&*shader.specializations);
+    spirv_to_dxil::spirv_to_dxil(
+        &shader.words,
+        specializations,
+        "main",
+        shader.stage,
+        ValidatorVersion::None,
+        &RuntimeConfig::default(),
+    )
+    .unwrap_or_else(|err| panic!("failed to compile {}: {err}", shader.name))
+}
+
+fn bench_shaders(c: &mut Criterion, group: &str, shaders: &[Shader]) {
+    let mut group = c.benchmark_group(group);
+    for shader in shaders {
+        group.throughput(Throughput::Bytes((shader.words.len() * 4) as u64));
+        group.bench_with_input(
+            BenchmarkId::from_parameter(&shader.name),
+            shader,
+            |b, shader| b.iter(|| compile(black_box(shader))),
+        );
+    }
+    group.finish();
+}
+
+fn stages(c: &mut Criterion) {
+    bench_shaders(c, "spirv_to_dxil/stage", &corpus::stages());
+}
+
+fn large_modules(c: &mut Criterion) {
+    let shaders: Vec<Shader> = [64, 256, 1024]
+        .into_iter()
+        .map(corpus::large_fragment)
+        .collect();
+    bench_shaders(c, "spirv_to_dxil/large", &shaders);
+}
+
+fn specializations(c: &mut Criterion) {
+    let shaders: Vec<Shader> = [16, 64, 256]
+        .into_iter()
+        .map(corpus::specialized_vertex)
+        .collect();
+    bench_shaders(c, "spirv_to_dxil/specialization", &shaders);
+}
+
+/// Translate to NIR without emitting DXIL.
+///
+/// Most of this time is spent formatting NIR as text, not in translation, so this is not a
+/// measure of the front half of a compile; see the `profile` feature for that.
+fn dump_nir(c: &mut Criterion) {
+    let shader = corpus::fragment();
+    c.bench_function("dump_nir", |b| {
+        b.iter(|| {
+            spirv_to_dxil::dump_nir(
+                black_box(&shader.words),
+                None,
+                "main",
+                shader.stage,
+                ValidatorVersion::None,
+                &RuntimeConfig::default(),
+            )
+            .expect("failed to dump NIR")
+        })
+    });
+}
+
+/// Compiles spread over a growing number of threads, to show how throughput scales with cores.
+fn threads(c: &mut Criterion) {
+    const COMPILES_PER_THREAD: usize = 4;
+    let shaders = corpus::stages();
+
+    let mut group = c.benchmark_group("spirv_to_dxil/threads");
+    group.sample_size(10);
+    for threads in [1, 2, 4, 8, 16, 32, 64] {
+        group.throughput(Throughput::Elements((threads * COMPILES_PER_THREAD) as u64));
+        group.bench_with_input(
+            BenchmarkId::from_parameter(threads),
+            &threads,
+            |b, &threads| {
+                b.iter(|| {
+                    std::thread::scope(|scope| {
+                        for thread in 0..threads {
+                            let shaders = &shaders;
+                            scope.spawn(move || {
+                                for i in 0..COMPILES_PER_THREAD {
+                                    let shader = &shaders[(thread + i) % shaders.len()];
+                                    black_box(compile(shader));
+                                }
+                            });
+                        }
+                    })
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+fn sign(c: &mut Criterion) {
+    let mut shaders = corpus::stages();
+    shaders.push(corpus::large_fragment(1024));
+
+    let mut group = c.benchmark_group("dxcsa/sign");
+    for shader in &shaders {
+        let blob = compile(shader).to_vec();
+        group.throughput(Throughput::Bytes(blob.len() as u64));
+        group.bench_with_input(
+            BenchmarkId::from_parameter(&shader.name),
+            &blob,
+            |b, blob| {
+                let mut out = [0u32; 4];
+                b.iter(|| mach_siegbert_vogt_dxcsa::sign(black_box(blob), &mut out))
+            },
+        );
+    }
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    stages,
+    large_modules,
+    specializations,
+    dump_nir,
+    threads,
+    sign
+);
+criterion_main!(benches);
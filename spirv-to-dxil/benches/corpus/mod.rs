@@ -0,0 +1,650 @@
+//! Generated SPIR-V modules for benchmarking.
+//!
+//! The corpus is assembled directly from SPIR-V opcodes so that benchmarks do not depend on an
+//! external shader compiler, and so that module size and specialization constant count can be
+//! scaled freely.
+
+use spirv_to_dxil::{ConstValue, ShaderStage, Specialization};
+
+mod op {
+    pub const MEMORY_MODEL: u16 = 14;
+    pub const ENTRY_POINT: u16 = 15;
+    pub const EXECUTION_MODE: u16 = 16;
+    pub const CAPABILITY: u16 = 17;
+    pub const TYPE_VOID: u16 = 19;
+    pub const TYPE_INT: u16 = 21;
+    pub const TYPE_FLOAT: u16 = 22;
+    pub const TYPE_VECTOR: u16 = 23;
+    pub const TYPE_ARRAY: u16 = 28;
+    pub const TYPE_RUNTIME_ARRAY: u16 = 29;
+    pub const TYPE_STRUCT: u16 = 30;
+    pub const TYPE_POINTER: u16 = 32;
+    pub const TYPE_FUNCTION: u16 = 33;
+    pub const CONSTANT: u16 = 43;
+    pub const CONSTANT_COMPOSITE: u16 = 44;
+    pub const SPEC_CONSTANT: u16 = 50;
+    pub const FUNCTION: u16 = 54;
+    pub const FUNCTION_PARAMETER: u16 = 55;
+    pub const FUNCTION_END: u16 = 56;
+    pub const FUNCTION_CALL: u16 = 57;
+    pub const VARIABLE: u16 = 59;
+    pub const LOAD: u16 = 61;
+    pub const STORE: u16 = 62;
+    pub const ACCESS_CHAIN: u16 = 65;
+    pub const DECORATE: u16 = 71;
+    pub const MEMBER_DECORATE: u16 = 72;
+    pub const COMPOSITE_CONSTRUCT: u16 = 80;
+    pub const COMPOSITE_EXTRACT: u16 = 81;
+    pub const CONVERT_U_TO_F: u16 = 112;
+    pub const F_ADD: u16 = 129;
+    pub const VECTOR_TIMES_SCALAR: u16 = 142;
+    pub const EMIT_VERTEX: u16 = 218;
+    pub const END_PRIMITIVE: u16 = 219;
+    pub const LABEL: u16 = 248;
+    pub const RETURN: u16 = 253;
+    pub const RETURN_VALUE: u16 = 254;
+}
+
+mod decoration {
+    pub const SPEC_ID: u32 = 1;
+    pub const BUFFER_BLOCK: u32 = 3;
+    pub const ARRAY_STRIDE: u32 = 6;
+    pub const BUILT_IN: u32 = 11;
+    pub const PATCH: u32 = 15;
+    pub const LOCATION: u32 = 30;
+    pub const BINDING: u32 = 33;
+    pub const DESCRIPTOR_SET: u32 = 34;
+    pub const OFFSET: u32 = 35;
+}
+
+mod built_in {
+    pub const POSITION: u32 = 0;
+    pub const INVOCATION_ID: u32 = 8;
+    pub const TESS_LEVEL_OUTER: u32 = 11;
+    pub const TESS_LEVEL_INNER: u32 = 12;
+    pub const TESS_COORD: u32 = 13;
+    pub const GLOBAL_INVOCATION_ID: u32 = 28;
+}
+
+mod storage {
+    pub const INPUT: u32 = 1;
+    pub const UNIFORM: u32 = 2;
+    pub const OUTPUT: u32 = 3;
+}
+
+mod mode {
+    pub const INVOCATIONS: u32 = 0;
+    pub const SPACING_EQUAL: u32 = 1;
+    pub const VERTEX_ORDER_CCW: u32 = 5;
+    pub const ORIGIN_UPPER_LEFT: u32 = 7;
+    pub const LOCAL_SIZE: u32 = 17;
+    pub const TRIANGLES: u32 = 22;
+    pub const OUTPUT_VERTICES: u32 = 26;
+    pub const OUTPUT_TRIANGLE_STRIP: u32 = 29;
+}
+
+const CAPABILITY_SHADER: u32 = 1;
+const CAPABILITY_GEOMETRY: u32 = 2;
+const CAPABILITY_TESSELLATION: u32 = 3;
+
+/// Encode a literal string as null-terminated, little-endian packed words.
+fn literal_string(str: &str) -> Vec<u32> {
+    let mut bytes = str.as_bytes().to_vec();
+    bytes.push(0);
+    bytes.resize(bytes.len().next_multiple_of(4), 0);
+    bytes
+        .chunks_exact(4)
+        .map(|b| u32::from_le_bytes([b[0], b[1], b[2], b[3]]))
+        .collect()
+}
+
+fn emit(section: &mut Vec<u32>, opcode: u16, operands: &[u32]) {
+    section.push(((operands.len() as u32 + 1) << 16) | opcode as u32);
+    section.extend_from_slice(operands);
+}
+
+/// Commonly used type ids.
+#[derive(Copy, Clone)]
+struct Types {
+    void: u32,
+    void_fn: u32,
+    uint: u32,
+    float: u32,
+    vec3: u32,
+    uvec3: u32,
+    vec4: u32,
+}
+
+/// A minimal SPIR-V module assembler that emits instructions into their logical layout sections.
+struct Builder {
+    bound: u32,
+    capabilities: Vec<u32>,
+    entry_points: Vec<u32>,
+    execution_modes: Vec<u32>,
+    annotations: Vec<u32>,
+    globals: Vec<u32>,
+    functions: Vec<u32>,
+    types: Types,
+}
+
+impl Builder {
+    fn new(capabilities: &[u32]) -> Self {
+        let mut builder = Builder {
+            bound: 1,
+            capabilities: Vec::new(),
+            entry_points: Vec::new(),
+            execution_modes: Vec::new(),
+            annotations: Vec::new(),
+            globals: Vec::new(),
+            functions: Vec::new(),
+            types: Types {
+                void: 0,
+                void_fn: 0,
+                uint: 0,
+                float: 0,
+                vec3: 0,
+                uvec3: 0,
+                vec4: 0,
+            },
+        };
+
+        for &capability in capabilities {
+            emit(&mut builder.capabilities, op::CAPABILITY, &[capability]);
+        }
+
+        let void = builder.global(op::TYPE_VOID, &[]);
+        let void_fn = builder.global(op::TYPE_FUNCTION, &[void]);
+        let uint = builder.global(op::TYPE_INT, &[32, 0]);
+        let float = builder.global(op::TYPE_FLOAT, &[32]);
+        let vec3 = builder.global(op::TYPE_VECTOR, &[float, 3]);
+        let uvec3 = builder.global(op::TYPE_VECTOR, &[uint, 3]);
+        let vec4 = builder.global(op::TYPE_VECTOR, &[float, 4]);
+        builder.types = Types {
+            void,
+            void_fn,
+            uint,
+            float,
+            vec3,
+            uvec3,
+            vec4,
+        };
+
+        builder
+    }
+
+    fn id(&mut self) -> u32 {
+        let id = self.bound;
+        self.bound += 1;
+        id
+    }
+
+    /// Emit a type, constant or global variable whose result id is its first operand.
+    fn global(&mut self, opcode: u16, operands: &[u32]) -> u32 {
+        let id = self.id();
+        let mut words = vec![id];
+        words.extend_from_slice(operands);
+        emit(&mut self.globals, opcode, &words);
+        id
+    }
+
+    /// Emit a typed instruction, such as a constant, with a fresh result id.
+    fn typed_global(&mut self, opcode: u16, result_type: u32, operands: &[u32]) -> u32 {
+        let id = self.id();
+        let mut words = vec![result_type, id];
+        words.extend_from_slice(operands);
+        emit(&mut self.globals, opcode, &words);
+        id
+    }
+
+    /// Emit a typed instruction in the current function with a fresh result id.
+    fn code(&mut self, opcode: u16, result_type: u32, operands: &[u32]) -> u32 {
+        let id = self.id();
+        let mut words = vec![result_type, id];
+        words.extend_from_slice(operands);
+        emit(&mut self.functions, opcode, &words);
+        id
+    }
+
+    /// Emit an instruction without a result in the current function.
+    fn void_code(&mut self, opcode: u16, operands: &[u32]) {
+        emit(&mut self.functions, opcode, operands);
+    }
+
+    fn decorate(&mut self, target: u32, decoration: u32, operands: &[u32]) {
+        let mut words = vec![target, decoration];
+        words.extend_from_slice(operands);
+        emit(&mut self.annotations, op::DECORATE, &words);
+    }
+
+    fn pointer(&mut self, storage_class: u32, pointee: u32) -> u32 {
+        self.global(op::TYPE_POINTER, &[storage_class, pointee])
+    }
+
+    fn variable(&mut self, storage_class: u32, pointee: u32) -> u32 {
+        let pointer = self.pointer(storage_class, pointee);
+        self.typed_global(op::VARIABLE, pointer, &[storage_class])
+    }
+
+    fn uint_constant(&mut self, value: u32) -> u32 {
+        let uint = self.types.uint;
+        self.typed_global(op::CONSTANT, uint, &[value])
+    }
+
+    fn float_constant(&mut self, value: f32) -> u32 {
+        let float = self.types.float;
+        self.typed_global(op::CONSTANT, float, &[value.to_bits()])
+    }
+
+    fn array(&mut self, element: u32, len: u32) -> u32 {
+        let len = self.uint_constant(len);
+        self.global(op::TYPE_ARRAY, &[element, len])
+    }
+
+    fn begin_function(&mut self, result_type: u32, function_type: u32) -> u32 {
+        let function = self.id();
+        emit(
+            &mut self.functions,
+            op::FUNCTION,
+            &[result_type, function, 0, function_type],
+        );
+        let label = self.id();
+        emit(&mut self.functions, op::LABEL, &[label]);
+        function
+    }
+
+    fn end_function(&mut self) {
+        emit(&mut self.functions, op::RETURN, &[]);
+        emit(&mut self.functions, op::FUNCTION_END, &[]);
+    }
+
+    fn entry_point(&mut self, execution_model: u32, function: u32, interface: &[u32]) {
+        let mut words = vec![execution_model, function];
+        words.extend(literal_string("main"));
+        words.extend_from_slice(interface);
+        emit(&mut self.entry_points, op::ENTRY_POINT, &words);
+    }
+
+    fn execution_mode(&mut self, function: u32, mode: u32, operands: &[u32]) {
+        let mut words = vec![function, mode];
+        words.extend_from_slice(operands);
+        emit(&mut self.execution_modes, op::EXECUTION_MODE, &words);
+    }
+
+    fn finish(self) -> Vec<u32> {
+        let mut words = vec![0x07230203, 0x00010000, 0, self.bound, 0];
+        words.extend(self.capabilities);
+        emit(&mut words, op::MEMORY_MODEL, &[0, 1]);
+        words.extend(self.entry_points);
+        words.extend(self.execution_modes);
+        words.extend(self.annotations);
+        words.extend(self.globals);
+        words.extend(self.functions);
+        words
+    }
+}
+
+/// A shader in the benchmark corpus.
+pub struct Shader {
+    pub name: String,
+    pub stage: ShaderStage,
+    pub words: Vec<u32>,
+    pub specializations: Vec<Specialization>,
+}
+
+/// `out vec4 position = in vec4 attribute`.
+pub fn vertex() -> Shader {
+    let mut b = Builder::new(&[CAPABILITY_SHADER]);
+    let t = b.types;
+
+    let input = b.variable(storage::INPUT, t.vec4);
+    b.decorate(input, decoration::LOCATION, &[0]);
+    let position = b.variable(storage::OUTPUT, t.vec4);
+    b.decorate(position, decoration::BUILT_IN, &[built_in::POSITION]);
+
+    let main = b.begin_function(t.void, t.void_fn);
+    let value = b.code(op::LOAD, t.vec4, &[input]);
+    b.void_code(op::STORE, &[position, value]);
+    b.end_function();
+
+    b.entry_point(0, main, &[input, position]);
+
+    Shader {
+        name: String::from("vertex"),
+        stage: ShaderStage::Vertex,
+        words: b.finish(),
+        specializations: Vec::new(),
+    }
+}
+
+/// Pass through control points and set constant tessellation factors.
+pub fn tessellation_control() -> Shader {
+    let mut b = Builder::new(&[CAPABILITY_SHADER, CAPABILITY_TESSELLATION]);
+    let t = b.types;
+
+    let input_array = b.array(t.vec4, 32);
+    let output_array = b.array(t.vec4, 3);
+    let outer_array = b.array(t.float, 4);
+    let inner_array = b.array(t.float, 2);
+
+    let input = b.variable(storage::INPUT, input_array);
+    b.decorate(input, decoration::LOCATION, &[0]);
+    let output = b.variable(storage::OUTPUT, output_array);
+    b.decorate(output, decoration::LOCATION, &[0]);
+    let invocation_id = b.variable(storage::INPUT, t.uint);
+    b.decorate(
+        invocation_id,
+        decoration::BUILT_IN,
+        &[built_in::INVOCATION_ID],
+    );
+    let outer = b.variable(storage::OUTPUT, outer_array);
+    b.decorate(outer, decoration::BUILT_IN, &[built_in::TESS_LEVEL_OUTER]);
+    b.decorate(outer, decoration::PATCH, &[]);
+    let inner = b.variable(storage::OUTPUT, inner_array);
+    b.decorate(inner, decoration::BUILT_IN, &[built_in::TESS_LEVEL_INNER]);
+    b.decorate(inner, decoration::PATCH, &[]);
+
+    let input_ptr = b.pointer(storage::INPUT, t.vec4);
+    let output_ptr = b.pointer(storage::OUTPUT, t.vec4);
+    let level_ptr = b.pointer(storage::OUTPUT, t.float);
+    let level = b.float_constant(4.0);
+    let indices: Vec<u32> = (0..4).map(|i| b.uint_constant(i)).collect();
+
+    let main = b.begin_function(t.void, t.void_fn);
+    let index = b.code(op::LOAD, t.uint, &[invocation_id]);
+    let src = b.code(op::ACCESS_CHAIN, input_ptr, &[input, index]);
+    let value = b.code(op::LOAD, t.vec4, &[src]);
+    let dst = b.code(op::ACCESS_CHAIN, output_ptr, &[output, index]);
+    b.void_code(op::STORE, &[dst, value]);
+    for &i in &indices {
+        let dst = b.code(op::ACCESS_CHAIN, level_ptr, &[outer, i]);
+        b.void_code(op::STORE, &[dst, level]);
+    }
+    for &i in &indices[..2] {
+        let dst = b.code(op::ACCESS_CHAIN, level_ptr, &[inner, i]);
+        b.void_code(op::STORE, &[dst, level]);
+    }
+    b.end_function();
+
+    b.entry_point(1, main, &[input, output, invocation_id, outer, inner]);
+    b.execution_mode(main, mode::OUTPUT_VERTICES, &[3]);
+
+    Shader {
+        name: String::from("tessellation_control"),
+        stage: ShaderStage::TesselationControl,
+        words: b.finish(),
+        specializations: Vec::new(),
+    }
+}
+
+/// Interpolate triangle control points by the tessellation coordinate.
+pub fn tessellation_evaluation() -> Shader {
+    let mut b = Builder::new(&[CAPABILITY_SHADER, CAPABILITY_TESSELLATION]);
+    let t = b.types;
+
+    let input_array = b.array(t.vec4, 32);
+    let input = b.variable(storage::INPUT, input_array);
+    b.decorate(input, decoration::LOCATION, &[0]);
+    let tess_coord = b.variable(storage::INPUT, t.vec3);
+    b.decorate(tess_coord, decoration::BUILT_IN, &[built_in::TESS_COORD]);
+    let position = b.variable(storage::OUTPUT, t.vec4);
+    b.decorate(position, decoration::BUILT_IN, &[built_in::POSITION]);
+
+    let input_ptr = b.pointer(storage::INPUT, t.vec4);
+    let indices: Vec<u32> = (0..3).map(|i| b.uint_constant(i)).collect();
+
+    let main = b.begin_function(t.void, t.void_fn);
+    let coord = b.code(op::LOAD, t.vec3, &[tess_coord]);
+    let mut sum = None;
+    for (component, &i) in indices.iter().enumerate() {
+        let src = b.code(op::ACCESS_CHAIN, input_ptr, &[input, i]);
+        let point = b.code(op::LOAD, t.vec4, &[src]);
+        let weight = b.code(op::COMPOSITE_EXTRACT, t.float, &[coord, component as u32]);
+        let weighted = b.code(op::VECTOR_TIMES_SCALAR, t.vec4, &[point, weight]);
+        sum = Some(match sum {
+            None => weighted,
+            Some(sum) => b.code(op::F_ADD, t.vec4, &[sum, weighted]),
+        });
+    }
+    b.void_code(op::STORE, &[position, sum.unwrap()]);
+    b.end_function();
+
+    b.entry_point(2, main, &[input, tess_coord, position]);
+    b.execution_mode(main, mode::TRIANGLES, &[]);
+    b.execution_mode(main, mode::SPACING_EQUAL, &[]);
+    b.execution_mode(main, mode::VERTEX_ORDER_CCW, &[]);
+
+    Shader {
+        name: String::from("tessellation_evaluation"),
+        stage: ShaderStage::TesselationEvaluation,
+        words: b.finish(),
+        specializations: Vec::new(),
+    }
+}
+
+/// Emit the input triangle unchanged.
+pub fn geometry() -> Shader {
+    let mut b = Builder::new(&[CAPABILITY_SHADER, CAPABILITY_GEOMETRY]);
+    let t = b.types;
+
+    let input_array = b.array(t.vec4, 3);
+    let input = b.variable(storage::INPUT, input_array);
+    b.decorate(input, decoration::LOCATION, &[0]);
+    let position = b.variable(storage::OUTPUT, t.vec4);
+    b.decorate(position, decoration::BUILT_IN, &[built_in::POSITION]);
+
+    let input_ptr = b.pointer(storage::INPUT, t.vec4);
+    let indices: Vec<u32> = (0..3).map(|i| b.uint_constant(i)).collect();
+
+    let main = b.begin_function(t.void, t.void_fn);
+    for &i in &indices {
+        let src = b.code(op::ACCESS_CHAIN, input_ptr, &[input, i]);
+        let value = b.code(op::LOAD, t.vec4, &[src]);
+        b.void_code(op::STORE, &[position, value]);
+        b.void_code(op::EMIT_VERTEX, &[]);
+    }
+    b.void_code(op::END_PRIMITIVE, &[]);
+    b.end_function();
+
+    b.entry_point(3, main, &[input, position]);
+    b.execution_mode(main, mode::TRIANGLES, &[]);
+    b.execution_mode(main, mode::INVOCATIONS, &[1]);
+    b.execution_mode(main, mode::OUTPUT_TRIANGLE_STRIP, &[]);
+    b.execution_mode(main, mode::OUTPUT_VERTICES, &[3]);
+
+    Shader {
+        name: String::from("geometry"),
+        stage: ShaderStage::Geometry,
+        words: b.finish(),
+        specializations: Vec::new(),
+    }
+}
+
+/// `out vec4 color = in vec4 color`.
+pub fn fragment() -> Shader {
+    let mut b = Builder::new(&[CAPABILITY_SHADER]);
+    let t = b.types;
+
+    let input = b.variable(storage::INPUT, t.vec4);
+    b.decorate(input, decoration::LOCATION, &[0]);
+    let output = b.variable(storage::OUTPUT, t.vec4);
+    b.decorate(output, decoration::LOCATION, &[0]);
+
+    let main = b.begin_function(t.void, t.void_fn);
+    let value = b.code(op::LOAD, t.vec4, &[input]);
+    b.void_code(op::STORE, &[output, value]);
+    b.end_function();
+
+    b.entry_point(4, main, &[input, output]);
+    b.execution_mode(main, mode::ORIGIN_UPPER_LEFT, &[]);
+
+    Shader {
+        name: String::from("fragment"),
+        stage: ShaderStage::Fragment,
+        words: b.finish(),
+        specializations: Vec::new(),
+    }
+}
+
+/// Write the global invocation ID to a storage buffer.
+pub fn compute() -> Shader {
+    let mut b = Builder::new(&[CAPABILITY_SHADER]);
+    let t = b.types;
+
+    let runtime_array = b.global(op::TYPE_RUNTIME_ARRAY, &[t.float]);
+    b.decorate(runtime_array, decoration::ARRAY_STRIDE, &[4]);
+    let block = b.global(op::TYPE_STRUCT, &[runtime_array]);
+    b.decorate(block, decoration::BUFFER_BLOCK, &[]);
+    emit(
+        &mut b.annotations,
+        op::MEMBER_DECORATE,
+        &[block, 0, decoration::OFFSET, 0],
+    );
+    let buffer = b.variable(storage::UNIFORM, block);
+    b.decorate(buffer, decoration::DESCRIPTOR_SET, &[0]);
+    b.decorate(buffer, decoration::BINDING, &[0]);
+
+    let invocation_id = b.variable(storage::INPUT, t.uvec3);
+    b.decorate(
+        invocation_id,
+        decoration::BUILT_IN,
+        &[built_in::GLOBAL_INVOCATION_ID],
+    );
+
+    let element_ptr = b.pointer(storage::UNIFORM, t.float);
+    let zero = b.uint_constant(0);
+
+    let main = b.begin_function(t.void, t.void_fn);
+    let id = b.code(op::LOAD, t.uvec3, &[invocation_id]);
+    let x = b.code(op::COMPOSITE_EXTRACT, t.uint, &[id, 0]);
+    let value = b.code(op::CONVERT_U_TO_F, t.float, &[x]);
+    let dst = b.code(op::ACCESS_CHAIN, element_ptr, &[buffer, zero, x]);
+    b.void_code(op::STORE, &[dst, value]);
+    b.end_function();
+
+    b.entry_point(5, main, &[invocation_id]);
+    b.execution_mode(main, mode::LOCAL_SIZE, &[64, 1, 1]);
+
+    Shader {
+        name: String::from("compute"),
+        stage: ShaderStage::Compute,
+        words: b.finish(),
+        specializations: Vec::new(),
+    }
+}
+
+/// A fragment shader that threads its input through a chain of `functions` helper functions,
+/// each computing a multiply-add with its own constants.
+pub fn large_fragment(functions: u32) -> Shader {
+    let mut b = Builder::new(&[CAPABILITY_SHADER]);
+    let t = b.types;
+
+    let input = b.variable(storage::INPUT, t.vec4);
+    b.decorate(input, decoration::LOCATION, &[0]);
+    let output = b.variable(storage::OUTPUT, t.vec4);
+    b.decorate(output, decoration::LOCATION, &[0]);
+
+    let helper_fn = b.global(op::TYPE_FUNCTION, &[t.vec4, t.vec4]);
+
+    let mut helpers = Vec::new();
+    for i in 0..functions {
+        let scale = b.float_constant(1.0 + i as f32 / functions as f32);
+        let bias = b.float_constant(i as f32);
+        let bias = b.typed_global(op::CONSTANT_COMPOSITE, t.vec4, &[bias, bias, bias, bias]);
+
+        let function = b.id();
+        emit(
+            &mut b.functions,
+            op::FUNCTION,
+            &[t.vec4, function, 0, helper_fn],
+        );
+        let param = b.code(op::FUNCTION_PARAMETER, t.vec4, &[]);
+        let label = b.id();
+        emit(&mut b.functions, op::LABEL, &[label]);
+        let scaled = b.code(op::VECTOR_TIMES_SCALAR, t.vec4, &[param, scale]);
+        let result = b.code(op::F_ADD, t.vec4, &[scaled, bias]);
+        b.void_code(op::RETURN_VALUE, &[result]);
+        b.void_code(op::FUNCTION_END, &[]);
+
+        helpers.push(function);
+    }
+
+    let main = b.begin_function(t.void, t.void_fn);
+    let mut value = b.code(op::LOAD, t.vec4, &[input]);
+    for helper in helpers {
+        value = b.code(op::FUNCTION_CALL, t.vec4, &[helper, value]);
+    }
+    b.void_code(op::STORE, &[output, value]);
+    b.end_function();
+
+    b.entry_point(4, main, &[input, output]);
+    b.execution_mode(main, mode::ORIGIN_UPPER_LEFT, &[]);
+
+    Shader {
+        name: format!("large_fragment_{functions}"),
+        stage: ShaderStage::Fragment,
+        words: b.finish(),
+        specializations: Vec::new(),
+    }
+}
+
+/// A vertex shader whose position is offset by the sum of `count` float specialization
+/// constants, compiled with every constant specialized.
+pub fn specialized_vertex(count: u32) -> Shader {
+    let mut b = Builder::new(&[CAPABILITY_SHADER]);
+    let t = b.types;
+
+    let input = b.variable(storage::INPUT, t.vec4);
+    b.decorate(input, decoration::LOCATION, &[0]);
+    let position = b.variable(storage::OUTPUT, t.vec4);
+    b.decorate(position, decoration::BUILT_IN, &[built_in::POSITION]);
+
+    let constants: Vec<u32> = (0..count)
+        .map(|i| {
+            let constant = b.typed_global(op::SPEC_CONSTANT, t.float, &[0f32.to_bits()]);
+            b.decorate(constant, decoration::SPEC_ID, &[i]);
+            constant
+        })
+        .collect();
+
+    let main = b.begin_function(t.void, t.void_fn);
+    let mut value = b.code(op::LOAD, t.vec4, &[input]);
+    for constant in constants {
+        let offset = b.code(
+            op::COMPOSITE_CONSTRUCT,
+            t.vec4,
+            &[constant, constant, constant, constant],
+        );
+        value = b.code(op::F_ADD, t.vec4, &[value, offset]);
+    }
+    b.void_code(op::STORE, &[position, value]);
+    b.end_function();
+
+    b.entry_point(0, main, &[input, position]);
+
+    let specializations = (0..count)
+        .map(|id| Specialization {
+            id,
+            value: ConstValue::Float32(id as f32),
+            defined_on_module: false,
+        })
+        .collect();
+
+    Shader {
+        name: format!("specialized_vertex_{count}"),
+        stage: ShaderStage::Vertex,
+        words: b.finish(),
+        specializations,
+    }
+}
+
+/// One shader per supported stage.
+pub fn stages() -> Vec<Shader> {
+    vec![
+        vertex(),
+        tessellation_control(),
+        tessellation_evaluation(),
+        geometry(),
+        fragment(),
+        compute(),
+    ]
+}
@@ -0,0 +1,65 @@
+use crate::{RuntimeConfig, ShaderStage, Specialization, ValidatorVersion};
+use std::num::NonZeroUsize;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+/// A single compilation in a batch passed to [`spirv_to_dxil_batch`](crate::spirv_to_dxil_batch).
+#[derive(Debug, Copy, Clone)]
+pub struct CompileJob<'a> {
+    pub spirv_words: &'a [u32],
+    pub specializations: Option<&'a [Specialization]>,
+    pub entry_point: &'a str,
+    pub stage: ShaderStage,
+    pub validator_version_max: ValidatorVersion,
+    pub runtime_conf: &'a RuntimeConfig,
+}
+
+/// Map `f` over `items` on a scoped pool of worker threads, returning results in input order.
+///
+/// Workers pull the next unclaimed index from a shared cursor, so a thread that finishes a cheap
+/// item immediately takes on more work instead of waiting on a fixed partition.
+pub(crate) fn parallel_map<T, R, F>(items: &[T], f: F) -> Vec<R>
+where
+    T: Sync,
+    R: Send,
+    F: Fn(&T) -> R + Sync,
+{
+    let threads = std::thread::available_parallelism()
+        .map(NonZeroUsize::get)
+        .unwrap_or(1)
+        .min(items.len());
+
+    if threads <= 1 {
+        return items.iter().map(f).collect();
+    }
+
+    let cursor = AtomicUsize::new(0);
+    let mut indexed: Vec<(usize, R)> = std::thread::scope(|scope| {
+        let workers: Vec<_> = (0..threads)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut done = Vec::new();
+                    loop {
+                        let index = cursor.fetch_add(1, Ordering::Relaxed);
+                        let Some(item) = items.get(index) else {
+                            break;
+                        };
+                        done.push((index, f(item)));
+                    }
+                    done
+                })
+            })
+            .collect();
+
+        workers
+            .into_iter()
+            .flat_map(|worker| {
+                worker
+                    .join()
+                    .unwrap_or_else(|panic| std::panic::resume_unwind(panic))
+            })
+            .collect()
+    });
+
+    indexed.sort_unstable_by_key(|(index, _)| *index);
+    indexed.into_iter().map(|(_, result)| result).collect()
+}
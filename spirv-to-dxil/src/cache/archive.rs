@@ -0,0 +1,279 @@
+use crate::cache::CompileKey;
+use crate::{DxilObject, SpirvToDxilError};
+use std::collections::BTreeMap;
+use std::io::{self, Write};
+
+const MAGIC: [u8; 4] = *b"S2DA";
+const FORMAT_VERSION: u32 = 1;
+/// Magic, format version, entry count and reserved space.
+const HEADER_SIZE: usize = 16;
+/// Key, blob offset, blob length, flags and reserved space.
+const INDEX_ENTRY_SIZE: usize = 16 + 8 + 8 + 4 + 4;
+/// Blobs start on this alignment relative to the start of the archive.
+const BLOB_ALIGNMENT: usize = 16;
+const FLAG_REQUIRES_RUNTIME_DATA: u32 = 1 << 0;
+
+fn read_u32(bytes: &[u8], offset: usize) -> u32 {
+    u32::from_le_bytes(bytes[offset..offset + 4].try_into().unwrap())
+}
+
+fn read_u64(bytes: &[u8], offset: usize) -> u64 {
+    u64::from_le_bytes(bytes[offset..offset + 8].try_into().unwrap())
+}
+
+/// Builds a [`ShaderArchive`] from compiled objects.
+///
+/// Objects are borrowed until the archive is written. Inserting a key twice keeps the last object.
+#[derive(Default)]
+pub struct ShaderArchiveWriter<'a> {
+    entries: BTreeMap<CompileKey, &'a DxilObject>,
+}
+
+impl<'a> ShaderArchiveWriter<'a> {
+    /// Create an empty archive.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Add a compiled object to the archive.
+    pub fn insert(&mut self, key: CompileKey, object: &'a DxilObject) {
+        self.entries.insert(key, object);
+    }
+
+    /// The number of objects in the archive.
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    /// Whether the archive is empty.
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// Write the archive.
+    ///
+    /// The archive is written front to back in a single pass, so `writer` may be a file, a socket
+    /// or any other stream.
+    pub fn write_to(&self, mut writer: impl Write) -> io::Result<()> {
+        let mut header = [0u8; HEADER_SIZE];
+        header[0..4].copy_from_slice(&MAGIC);
+        header[4..8].copy_from_slice(&FORMAT_VERSION.to_le_bytes());
+        header[8..12].copy_from_slice(&(self.entries.len() as u32).to_le_bytes());
+        writer.write_all(&header)?;
+
+        let index_end = HEADER_SIZE + self.entries.len() * INDEX_ENTRY_SIZE;
+        let mut offset = index_end.next_multiple_of(BLOB_ALIGNMENT);
+
+        for (key, object) in &self.entries {
+            let mut flags = 0;
+            if object.requires_runtime_data() {
+                flags |= FLAG_REQUIRES_RUNTIME_DATA;
+            }
+
+            let mut entry = [0u8; INDEX_ENTRY_SIZE];
+            entry[0..16].copy_from_slice(key.as_bytes());
+            entry[16..24].copy_from_slice(&(offset as u64).to_le_bytes());
+            entry[24..32].copy_from_slice(&(object.len() as u64).to_le_bytes());
+            entry[32..36].copy_from_slice(&flags.to_le_bytes());
+            writer.write_all(&entry)?;
+
+            offset = (offset + object.len()).next_multiple_of(BLOB_ALIGNMENT);
+        }
+
+        let padding = [0u8; BLOB_ALIGNMENT];
+        let mut position = index_end;
+        for object in self.entries.values() {
+            writer.write_all(&padding[..position.next_multiple_of(BLOB_ALIGNMENT) - position])?;
+            writer.write_all(object)?;
+            position = position.next_multiple_of(BLOB_ALIGNMENT) + object.len();
+        }
+
+        writer.flush()
+    }
+}
+
+/// A compiled object stored in a [`ShaderArchive`].
+#[derive(Debug, Copy, Clone)]
+pub struct ArchiveEntry<'a> {
+    /// The key the object was stored under.
+    pub key: CompileKey,
+    /// The compiled DXIL container.
+    pub bytes: &'a [u8],
+    /// Whether the compiled shader requires runtime data to be bound.
+    pub requires_runtime_data: bool,
+}
+
+impl ArchiveEntry<'_> {
+    /// Copy the entry into an owned [`DxilObject`].
+    pub fn to_object(&self) -> DxilObject {
+        DxilObject::from_owned(self.bytes.into(), self.requires_runtime_data)
+    }
+}
+
+/// A read-only view of a packed archive of compiled objects.
+///
+/// An archive holds many compiled objects, indexed by [`CompileKey`] in sorted order, in a single
+/// file written by [`ShaderArchiveWriter`]. The view borrows the archive bytes and looks entries
+/// up with a binary search of the index, returning slices of the archive without copying or
+/// allocating.
+///
+/// The archive bytes can come from memory-mapping the file, in which case only the pages of the
+/// index and of the entries that are looked up are ever read from disk. Blobs are aligned to 16
+/// bytes from the start of the archive.
+#[derive(Debug, Clone)]
+pub struct ShaderArchive<'a> {
+    bytes: &'a [u8],
+    index: &'a [u8],
+}
+
+impl<'a> ShaderArchive<'a> {
+    /// Validate the header and index of an archive.
+    pub fn new(bytes: &'a [u8]) -> Result<Self, SpirvToDxilError> {
+        if bytes.len() < HEADER_SIZE || bytes[0..4] != MAGIC {
+            return Err(SpirvToDxilError::InvalidArchive("missing archive header"));
+        }
+
+        if read_u32(bytes, 4) != FORMAT_VERSION {
+            return Err(SpirvToDxilError::InvalidArchive(
+                "unsupported archive version",
+            ));
+        }
+
+        let count = read_u32(bytes, 8) as usize;
+        let Some(index) = count
+            .checked_mul(INDEX_ENTRY_SIZE)
+            .and_then(|size| bytes.get(HEADER_SIZE..HEADER_SIZE.checked_add(size)?))
+        else {
+            return Err(SpirvToDxilError::InvalidArchive("index out of bounds"));
+        };
+
+        let mut previous: Option<&[u8]> = None;
+        for entry in index.chunks_exact(INDEX_ENTRY_SIZE) {
+            let offset = read_u64(entry, 16);
+            let len = read_u64(entry, 24);
+            if offset
+                .checked_add(len)
+                .map_or(true, |end| end > bytes.len() as u64)
+            {
+                return Err(SpirvToDxilError::InvalidArchive("entry out of bounds"));
+            }
+
+            let key = &entry[0..16];
+            if previous.is_some_and(|previous| previous >= key) {
+                return Err(SpirvToDxilError::InvalidArchive("index is not sorted"));
+            }
+            previous = Some(key);
+        }
+
+        Ok(Self { bytes, index })
+    }
+
+    /// The number of entries in the archive.
+    pub fn len(&self) -> usize {
+        self.index.len() / INDEX_ENTRY_SIZE
+    }
+
+    /// Whether the archive is empty.
+    pub fn is_empty(&self) -> bool {
+        self.index.is_empty()
+    }
+
+    fn entry_at(&self, index: usize) -> ArchiveEntry<'a> {
+        // Bounds were checked when the archive was opened.
+        let entry = &self.index[index * INDEX_ENTRY_SIZE..][..INDEX_ENTRY_SIZE];
+        let offset = read_u64(entry, 16) as usize;
+        let len = read_u64(entry, 24) as usize;
+
+        ArchiveEntry {
+            key: CompileKey::from_bytes(entry[0..16].try_into().unwrap()),
+            bytes: &self.bytes[offset..offset + len],
+            requires_runtime_data: read_u32(entry, 32) & FLAG_REQUIRES_RUNTIME_DATA != 0,
+        }
+    }
+
+    /// Look up an entry by key.
+    pub fn get(&self, key: &CompileKey) -> Option<ArchiveEntry<'a>> {
+        let (mut low, mut high) = (0, self.len());
+        while low < high {
+            let mid = low + (high - low) / 2;
+            let entry_key = &self.index[mid * INDEX_ENTRY_SIZE..][..16];
+            match entry_key.cmp(key.as_bytes()) {
+                std::cmp::Ordering::Less => low = mid + 1,
+                std::cmp::Ordering::Greater => high = mid,
+                std::cmp::Ordering::Equal => return Some(self.entry_at(mid)),
+            }
+        }
+        None
+    }
+
+    /// Iterate over the entries in key order.
+    pub fn entries(&self) -> impl ExactSizeIterator<Item = ArchiveEntry<'a>> + '_ {
+        (0..self.len()).map(|index| self.entry_at(index))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_archive_roundtrip() {
+        let objects: Vec<(CompileKey, DxilObject)> = (0..5u8)
+            .rev()
+            .map(|i| {
+                let key = CompileKey::from_bytes([i * 17; 16]);
+                let blob = vec![i; i as usize * 7 + 1].into_boxed_slice();
+                (key, DxilObject::from_owned(blob, i % 2 == 0))
+            })
+            .collect();
+
+        let mut writer = ShaderArchiveWriter::new();
+        for (key, object) in &objects {
+            writer.insert(*key, object);
+        }
+
+        let mut bytes = Vec::new();
+        writer
+            .write_to(&mut bytes)
+            .expect("failed to write archive");
+
+        let archive = ShaderArchive::new(&bytes).expect("failed to open archive");
+        assert_eq!(archive.len(), objects.len());
+
+        for (key, object) in &objects {
+            let entry = archive.get(key).expect("missing entry");
+            assert_eq!(entry.bytes, &**object);
+            assert_eq!(entry.requires_runtime_data, object.requires_runtime_data());
+            assert_eq!(
+                (entry.bytes.as_ptr() as usize - bytes.as_ptr() as usize) % BLOB_ALIGNMENT,
+                0
+            );
+        }
+
+        assert!(archive.get(&CompileKey::from_bytes([1; 16])).is_none());
+
+        let keys: Vec<CompileKey> = archive.entries().map(|entry| entry.key).collect();
+        let mut sorted = keys.clone();
+        sorted.sort();
+        assert_eq!(keys, sorted);
+    }
+
+    #[test]
+    fn test_archive_invalid() {
+        let object = DxilObject::from_owned(vec![1; 32].into_boxed_slice(), false);
+        let mut writer = ShaderArchiveWriter::new();
+        writer.insert(CompileKey::from_bytes([0; 16]), &object);
+
+        let mut bytes = Vec::new();
+        writer
+            .write_to(&mut bytes)
+            .expect("failed to write archive");
+
+        assert!(ShaderArchive::new(&bytes[..bytes.len() - 1]).is_err());
+        assert!(ShaderArchive::new(&bytes[..HEADER_SIZE]).is_err());
+
+        let mut version = bytes.clone();
+        version[4] = 2;
+        assert!(ShaderArchive::new(&version).is_err());
+    }
+}
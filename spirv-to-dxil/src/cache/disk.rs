@@ -0,0 +1,382 @@
+use crate::cache::CompileKey;
+use crate::{
+    DxilObject, RuntimeConfig, ShaderStage, Specialization, SpirvToDxilError, ValidatorVersion,
+};
+use std::fs::{File, OpenOptions};
+use std::io::{self, Read, Write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Mutex;
+use std::time::{Duration, SystemTime};
+
+const MAGIC: [u8; 4] = *b"S2DX";
+const FORMAT_VERSION: u32 = 1;
+const HEADER_SIZE: usize = 4 + 4 + 4 + 16 + 8;
+const FLAG_REQUIRES_RUNTIME_DATA: u32 = 1 << 0;
+const EXTENSION: &str = "dxil";
+const TEMP_EXTENSION: &str = "tmp";
+/// How old a temporary file must be before it is assumed to belong to a writer that crashed.
+const STALE_TEMP_AGE: Duration = Duration::from_secs(60 * 60);
+
+/// A persistent, content-addressed cache of compiled DXIL.
+///
+/// Entries are keyed on a [`CompileKey`] and stored one per file under the cache directory.
+/// Writes are atomic: an entry is written to a temporary file and renamed into place, so
+/// concurrent readers, including other processes, never observe a partially written blob.
+///
+/// When the total size of the cache exceeds its limit, the least recently used entries are
+/// evicted. Recency is tracked with file modification times, which are refreshed on every hit.
+/// Temporary files left behind by a writer that crashed before renaming them are removed when
+/// the cache is opened or evicts entries, once they are an hour old.
+pub struct DiskCache {
+    root: PathBuf,
+    max_size: u64,
+    size: AtomicU64,
+    eviction: Mutex<()>,
+}
+
+impl DiskCache {
+    /// Open or create a cache in the directory `root`, holding at most `max_size` bytes of entries.
+    pub fn new(root: impl Into<PathBuf>, max_size: u64) -> io::Result<Self> {
+        let root = root.into();
+        std::fs::create_dir_all(&root)?;
+
+        let size = entries(&root)?.iter().map(|entry| entry.size).sum();
+
+        Ok(Self {
+            root,
+            max_size,
+            size: AtomicU64::new(size),
+            eviction: Mutex::new(()),
+        })
+    }
+
+    fn path(&self, key: &CompileKey) -> PathBuf {
+        let name = key.to_string();
+        self.root
+            .join(&name[..2])
+            .join(name)
+            .with_extension(EXTENSION)
+    }
+
+    /// Look up a cached compile result.
+    ///
+    /// Returns `None` if there is no entry for the key, or if the entry could not be read.
+    pub fn get(&self, key: &CompileKey) -> Option<DxilObject> {
+        let path = self.path(key);
+        let mut file = File::open(&path).ok()?;
+
+        let mut header = [0u8; HEADER_SIZE];
+        file.read_exact(&mut header).ok()?;
+
+        if header[0..4] != MAGIC
+            || u32::from_le_bytes(header[4..8].try_into().unwrap()) != FORMAT_VERSION
+            || &header[12..28] != key.as_bytes()
+        {
+            return None;
+        }
+
+        let flags = u32::from_le_bytes(header[8..12].try_into().unwrap());
+        let len = u64::from_le_bytes(header[28..36].try_into().unwrap());
+
+        // Check the length against the file before allocating for it, so that a truncated or
+        // corrupt entry is a miss rather than an allocation failure.
+        let file_len = file.metadata().ok()?.len();
+        if file_len.checked_sub(HEADER_SIZE as u64) != Some(len) {
+            return None;
+        }
+
+        let mut binary = Vec::with_capacity(usize::try_from(len).ok()?);
+        file.read_to_end(&mut binary).ok()?;
+        if binary.len() as u64 != len {
+            return None;
+        }
+
+        // Refresh the entry for LRU eviction. Failing to do so only affects eviction order.
+        let _ = OpenOptions::new()
+            .write(true)
+            .open(&path)
+            .and_then(|file| file.set_modified(SystemTime::now()));
+
+        Some(DxilObject::from_owned(
+            binary.into_boxed_slice(),
+            flags & FLAG_REQUIRES_RUNTIME_DATA != 0,
+        ))
+    }
+
+    /// Store a compile result in the cache, evicting old entries if the cache is over its limit.
+    pub fn insert(&self, key: &CompileKey, object: &DxilObject) -> io::Result<()> {
+        let path = self.path(key);
+        let dir = path.parent().unwrap();
+        std::fs::create_dir_all(dir)?;
+
+        let mut flags = 0;
+        if object.requires_runtime_data() {
+            flags |= FLAG_REQUIRES_RUNTIME_DATA;
+        }
+
+        let mut header = [0u8; HEADER_SIZE];
+        header[0..4].copy_from_slice(&MAGIC);
+        header[4..8].copy_from_slice(&FORMAT_VERSION.to_le_bytes());
+        header[8..12].copy_from_slice(&u32::to_le_bytes(flags));
+        header[12..28].copy_from_slice(key.as_bytes());
+        header[28..36].copy_from_slice(&(object.len() as u64).to_le_bytes());
+
+        static TEMP_COUNTER: AtomicU64 = AtomicU64::new(0);
+        let temp = dir.join(format!(
+            "{key}.{}.{}.{TEMP_EXTENSION}",
+            std::process::id(),
+            TEMP_COUNTER.fetch_add(1, Ordering::Relaxed)
+        ));
+
+        let written = File::create(&temp).and_then(|mut file| {
+            file.write_all(&header)?;
+            file.write_all(object)?;
+            file.sync_data()
+        });
+
+        // An existing entry for the key is replaced, and no longer counts towards the total.
+        let replaced = std::fs::metadata(&path).map_or(0, |metadata| metadata.len());
+
+        if let Err(err) = written.and_then(|_| std::fs::rename(&temp, &path)) {
+            let _ = std::fs::remove_file(&temp);
+            return Err(err);
+        }
+
+        let entry_size = (HEADER_SIZE + object.len()) as u64;
+        let update = |size: u64| size.saturating_sub(replaced) + entry_size;
+        let size = update(
+            self.size
+                .fetch_update(Ordering::Relaxed, Ordering::Relaxed, |size| {
+                    Some(update(size))
+                })
+                .unwrap(),
+        );
+        if size > self.max_size {
+            self.evict()?;
+        }
+
+        Ok(())
+    }
+
+    /// Evict least recently used entries until the cache is below 90% of its limit.
+    fn evict(&self) -> io::Result<()> {
+        let Ok(_guard) = self.eviction.try_lock() else {
+            // Another thread is already evicting.
+            return Ok(());
+        };
+
+        // Rescan rather than trusting the running total, which drifts if other
+        // processes share the cache directory.
+        let mut entries = entries(&self.root)?;
+        entries.sort_unstable_by_key(|entry| entry.modified);
+
+        let target = self.max_size - self.max_size / 10;
+        let mut size: u64 = entries.iter().map(|entry| entry.size).sum();
+
+        for entry in entries {
+            if size <= target {
+                break;
+            }
+
+            if std::fs::remove_file(&entry.path).is_ok() {
+                size -= entry.size;
+            }
+        }
+
+        self.size.store(size, Ordering::Relaxed);
+        Ok(())
+    }
+
+    /// Compile SPIR-V words to a DXIL blob, returning a cached result if one exists.
+    ///
+    /// Failing to write the result to the cache is not an error; the compiled object is
+    /// returned regardless.
+    ///
+    /// See [`spirv_to_dxil`](crate::spirv_to_dxil) for details on the parameters.
+    pub fn spirv_to_dxil(
+        &self,
+        spirv_words: &[u32],
+        specializations: Option<&[Specialization]>,
+        entry_point: impl AsRef<str>,
+        stage: ShaderStage,
+        validator_version_max: ValidatorVersion,
+        runtime_conf: &RuntimeConfig,
+    ) -> Result<DxilObject, SpirvToDxilError> {
+        let key = CompileKey::new(
+            spirv_words,
+            specializations,
+            entry_point.as_ref(),
+            stage,
+            validator_version_max,
+            runtime_conf,
+        );
+
+        if let Some(object) = self.get(&key) {
+            return Ok(object);
+        }
+
+        let object = crate::spirv_to_dxil(
+            spirv_words,
+            specializations,
+            entry_point,
+            stage,
+            validator_version_max,
+            runtime_conf,
+        )?;
+
+        let _ = self.insert(&key, &object);
+        Ok(object)
+    }
+}
+
+struct Entry {
+    path: PathBuf,
+    size: u64,
+    modified: SystemTime,
+}
+
+/// List the entries of the cache, removing stale temporary files along the way.
+fn entries(root: &Path) -> io::Result<Vec<Entry>> {
+    let now = SystemTime::now();
+    let mut entries = Vec::new();
+    for shard in std::fs::read_dir(root)? {
+        let shard = shard?;
+        if !shard.file_type()?.is_dir() {
+            continue;
+        }
+
+        for file in std::fs::read_dir(shard.path())? {
+            let file = file?;
+            let path = file.path();
+            let Some(extension) = path.extension() else {
+                continue;
+            };
+
+            if extension == EXTENSION {
+                let metadata = file.metadata()?;
+                entries.push(Entry {
+                    path,
+                    size: metadata.len(),
+                    modified: metadata.modified()?,
+                });
+            } else if extension == TEMP_EXTENSION {
+                // Another writer may still be writing a fresh one.
+                let stale = file
+                    .metadata()
+                    .and_then(|metadata| metadata.modified())
+                    .is_ok_and(|modified| {
+                        now.duration_since(modified)
+                            .is_ok_and(|age| age >= STALE_TEMP_AGE)
+                    });
+                if stale {
+                    let _ = std::fs::remove_file(&path);
+                }
+            }
+        }
+    }
+
+    Ok(entries)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_disk_cache() {
+        let fragment: &[u8] = include_bytes!("../../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment: &[u32] = bytemuck::cast_slice(&fragment);
+
+        let root = std::env::temp_dir().join(format!("spirv-to-dxil-cache-{}", std::process::id()));
+        let cache = DiskCache::new(&root, 64 * 1024 * 1024).expect("failed to open cache");
+        let runtime_conf = RuntimeConfig::default();
+
+        let compiled = cache
+            .spirv_to_dxil(
+                fragment,
+                None,
+                "main",
+                ShaderStage::Fragment,
+                ValidatorVersion::None,
+                &runtime_conf,
+            )
+            .expect("failed to compile");
+
+        let key = CompileKey::new(
+            fragment,
+            None,
+            "main",
+            ShaderStage::Fragment,
+            ValidatorVersion::None,
+            &runtime_conf,
+        );
+        let cached = cache.get(&key).expect("entry was not cached");
+
+        assert_eq!(&*compiled, &*cached);
+        assert_eq!(
+            compiled.requires_runtime_data(),
+            cached.requires_runtime_data()
+        );
+
+        let _ = std::fs::remove_dir_all(&root);
+    }
+
+    #[test]
+    fn test_disk_cache_corrupt() {
+        let root = std::env::temp_dir().join(format!(
+            "spirv-to-dxil-cache-corrupt-{}",
+            std::process::id()
+        ));
+        let cache = DiskCache::new(&root, 64 * 1024 * 1024).expect("failed to open cache");
+        let key = CompileKey::from_bytes([7; 16]);
+        let object = DxilObject::from_owned(vec![1u8; 64].into_boxed_slice(), false);
+
+        cache.insert(&key, &object).expect("failed to insert");
+        cache.insert(&key, &object).expect("failed to insert");
+        assert_eq!(
+            cache.size.load(Ordering::Relaxed),
+            (HEADER_SIZE + object.len()) as u64
+        );
+        assert!(cache.get(&key).is_some());
+
+        let path = cache.path(&key);
+        let contents = std::fs::read(&path).expect("failed to read entry");
+
+        // Truncated
+        std::fs::write(&path, &contents[..contents.len() - 1]).unwrap();
+        assert!(cache.get(&key).is_none());
+        std::fs::write(&path, &contents[..HEADER_SIZE / 2]).unwrap();
+        assert!(cache.get(&key).is_none());
+
+        // A length that does not fit in memory
+        let mut corrupt = contents.clone();
+        corrupt[28..36].copy_from_slice(&u64::MAX.to_le_bytes());
+        std::fs::write(&path, &corrupt).unwrap();
+        assert!(cache.get(&key).is_none());
+
+        let _ = std::fs::remove_dir_all(&root);
+    }
+
+    #[test]
+    fn test_disk_cache_stale_temp() {
+        let root =
+            std::env::temp_dir().join(format!("spirv-to-dxil-cache-temp-{}", std::process::id()));
+        let shard = root.join("00");
+        std::fs::create_dir_all(&shard).unwrap();
+
+        let stale = shard.join(format!("00.1.0.{TEMP_EXTENSION}"));
+        let fresh = shard.join(format!("00.1.1.{TEMP_EXTENSION}"));
+        File::create(&stale)
+            .and_then(|file| file.set_modified(SystemTime::now() - 2 * STALE_TEMP_AGE))
+            .unwrap();
+        File::create(&fresh).unwrap();
+
+        DiskCache::new(&root, 64 * 1024 * 1024).expect("failed to open cache");
+        assert!(!stale.exists());
+        assert!(fresh.exists());
+
+        let _ = std::fs::remove_dir_all(&root);
+    }
+}
@@ -0,0 +1,276 @@
+use crate::strip::semantic_runs;
+use crate::{ConstValue, RuntimeConfig, ShaderStage, Specialization, ValidatorVersion};
+use std::fmt::{Display, Formatter};
+
+const FNV_OFFSET_BASIS: u128 = 0x6c62272e07bb014262b821756295c58d;
+const FNV_PRIME: u128 = 0x0000000001000000000000000000013b;
+
+/// 128-bit FNV-1a. Unlike `std::hash`, the output is stable across Rust versions and platforms,
+/// so it is suitable for naming files that outlive the process.
+struct KeyHasher(u128);
+
+impl KeyHasher {
+    fn new() -> Self {
+        KeyHasher(FNV_OFFSET_BASIS)
+    }
+
+    fn write(&mut self, bytes: &[u8]) {
+        for &byte in bytes {
+            self.0 ^= byte as u128;
+            self.0 = self.0.wrapping_mul(FNV_PRIME);
+        }
+    }
+
+    fn write_u8(&mut self, value: u8) {
+        self.write(&[value])
+    }
+
+    fn write_bool(&mut self, value: bool) {
+        self.write_u8(value as u8)
+    }
+
+    fn write_u16(&mut self, value: u16) {
+        self.write(&value.to_le_bytes())
+    }
+
+    fn write_u32(&mut self, value: u32) {
+        self.write(&value.to_le_bytes())
+    }
+
+    fn write_i32(&mut self, value: i32) {
+        self.write(&value.to_le_bytes())
+    }
+
+    fn write_u64(&mut self, value: u64) {
+        self.write(&value.to_le_bytes())
+    }
+
+    fn write_words(&mut self, words: &[u32]) {
+        self.write_u64(words.len() as u64);
+        for &word in words {
+            self.write_u32(word);
+        }
+    }
+
+    /// Write the words of a module that are not debug information.
+    ///
+    /// The generator and id bound in the header are skipped too, since they change with the
+    /// tools used and the number of debug strings without affecting the compiled shader.
+    fn write_semantic_words(&mut self, words: &[u32]) {
+        let mut hasher = KeyHasher(self.0);
+        for index in [0, 1, 4] {
+            hasher.write_u32(words.get(index).copied().unwrap_or_default());
+        }
+
+        let mut length = 0;
+        let runs = semantic_runs(words, |run| {
+            length += run.len();
+            for &word in run {
+                hasher.write_u32(word);
+            }
+        });
+
+        // Invalid modules are keyed on all of their words, and will fail to compile anyway.
+        match runs {
+            Ok(_) => {
+                hasher.write_u64(length as u64);
+                self.0 = hasher.0;
+            }
+            Err(_) => self.write_words(words),
+        }
+    }
+
+    fn write_str(&mut self, str: &str) {
+        self.write_u64(str.len() as u64);
+        self.write(str.as_bytes());
+    }
+
+    fn write_const_value(&mut self, value: ConstValue) {
+        let (tag, bits) = match value {
+            ConstValue::Bool(b) => (0, b as u64),
+            ConstValue::Float32(f) => (1, f.to_bits() as u64),
+            ConstValue::Float64(f) => (2, f.to_bits()),
+            ConstValue::Int8(i) => (3, i as u8 as u64),
+            ConstValue::Uint8(u) => (4, u as u64),
+            ConstValue::Int16(i) => (5, i as u16 as u64),
+            ConstValue::Uint16(u) => (6, u as u64),
+            ConstValue::Int32(i) => (7, i as u32 as u64),
+            ConstValue::Uint32(u) => (8, u as u64),
+            ConstValue::Int64(i) => (9, i as u64),
+            ConstValue::Uint64(u) => (10, u),
+        };
+        self.write_u8(tag);
+        self.write_u64(bits);
+    }
+
+    fn write_runtime_conf(&mut self, conf: &RuntimeConfig) {
+        self.write_u32(conf.runtime_data_cbv.register_space);
+        self.write_u32(conf.runtime_data_cbv.base_shader_register);
+        self.write_u32(conf.push_constant_cbv.register_space);
+        self.write_u32(conf.push_constant_cbv.base_shader_register);
+        self.write_bool(conf.zero_based_vertex_instance_id);
+        self.write_bool(conf.zero_based_compute_workgroup_id);
+        self.write_i32(conf.yz_flip.mode.0);
+        self.write_u16(conf.yz_flip.y_mask);
+        self.write_u16(conf.yz_flip.z_mask);
+        self.write_bool(conf.declared_read_only_images_as_srvs);
+        self.write_bool(conf.inferred_read_only_images_as_srvs);
+        self.write_bool(conf.force_sample_rate_shading);
+        self.write_bool(conf.lower_view_index);
+        self.write_bool(conf.lower_view_index_to_rt_layer);
+        self.write_i32(conf.shader_model_max as i32);
+    }
+
+    /// Write the compile inputs other than the module, and produce the key.
+    fn finish(
+        mut self,
+        specializations: Option<&[Specialization]>,
+        entry_point: &str,
+        stage: ShaderStage,
+        validator_version_max: ValidatorVersion,
+        runtime_conf: &RuntimeConfig,
+    ) -> CompileKey {
+        self.write_str(entry_point);
+        self.write_i32(stage as i32);
+        self.write_i32(validator_version_max as i32);
+        self.write_runtime_conf(runtime_conf);
+
+        let specializations = specializations.unwrap_or(&[]);
+        self.write_u64(specializations.len() as u64);
+        for specialization in specializations {
+            self.write_u32(specialization.id);
+            self.write_bool(specialization.defined_on_module);
+            self.write_const_value(specialization.value);
+        }
+
+        CompileKey(self.0.to_le_bytes())
+    }
+}
+
+/// A content hash of every input that affects the output of [`spirv_to_dxil`](crate::spirv_to_dxil).
+///
+/// The key also covers the version of the bundled spirv-to-dxil compiler, so keys computed against
+/// a different Mesa revision will never match.
+#[derive(Debug, Copy, Clone, Hash, PartialEq, Eq, PartialOrd, Ord)]
+pub struct CompileKey([u8; 16]);
+
+impl CompileKey {
+    /// Compute the key for the given compile inputs.
+    pub fn new(
+        spirv_words: &[u32],
+        specializations: Option<&[Specialization]>,
+        entry_point: impl AsRef<str>,
+        stage: ShaderStage,
+        validator_version_max: ValidatorVersion,
+        runtime_conf: &RuntimeConfig,
+    ) -> Self {
+        let mut hasher = KeyHasher::new();
+        hasher.write_u64(unsafe { spirv_to_dxil_sys::spirv_to_dxil_get_version() });
+        hasher.write_words(spirv_words);
+        hasher.finish(
+            specializations,
+            entry_point.as_ref(),
+            stage,
+            validator_version_max,
+            runtime_conf,
+        )
+    }
+
+    /// Compute a key for the given compile inputs that ignores the debug information in the
+    /// module.
+    ///
+    /// Builds of a shader that differ only in names, source text, line information or the
+    /// generator map to the same key, as long as the compiler assigned the same ids. The debug
+    /// instructions are skipped while hashing, as [`strip_debug_info`](crate::strip_debug_info)
+    /// would remove them, without copying the module.
+    ///
+    /// Since resource names come from the debug information, a cache keyed this way may return a
+    /// blob with the resource names of an earlier build.
+    pub fn new_ignoring_debug_info(
+        spirv_words: &[u32],
+        specializations: Option<&[Specialization]>,
+        entry_point: impl AsRef<str>,
+        stage: ShaderStage,
+        validator_version_max: ValidatorVersion,
+        runtime_conf: &RuntimeConfig,
+    ) -> Self {
+        let mut hasher = KeyHasher::new();
+        hasher.write_u64(unsafe { spirv_to_dxil_sys::spirv_to_dxil_get_version() });
+        hasher.write_semantic_words(spirv_words);
+        hasher.finish(
+            specializations,
+            entry_point.as_ref(),
+            stage,
+            validator_version_max,
+            runtime_conf,
+        )
+    }
+
+    /// The raw bytes of the key.
+    pub fn as_bytes(&self) -> &[u8; 16] {
+        &self.0
+    }
+
+    /// Reconstruct a key from the raw bytes returned by [`as_bytes`](CompileKey::as_bytes).
+    pub fn from_bytes(bytes: [u8; 16]) -> Self {
+        CompileKey(bytes)
+    }
+}
+
+impl Display for CompileKey {
+    fn fmt(&self, f: &mut Formatter<'_>) -> std::fmt::Result {
+        for byte in self.0 {
+            write!(f, "{byte:02x}")?;
+        }
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::module::{op, string};
+
+    fn key(spirv_words: &[u32]) -> CompileKey {
+        CompileKey::new_ignoring_debug_info(
+            spirv_words,
+            None,
+            "main",
+            ShaderStage::Compute,
+            ValidatorVersion::None,
+            &RuntimeConfig::default(),
+        )
+    }
+
+    #[test]
+    fn test_key_ignoring_debug_info() {
+        let module = |generator, name, local_size| {
+            [
+                vec![0x07230203, 0x00010000, generator, 5, 0],
+                op(17, &[1]),
+                op(14, &[0, 1]),
+                op(15, &[[5, 1].as_slice(), &string("main")].concat()),
+                op(16, &[1, 17, local_size, 1, 1]),
+                op(5, &[[1].as_slice(), &string(name)].concat()),
+                op(19, &[2]),
+            ]
+            .concat()
+        };
+
+        assert_eq!(key(&module(0, "main", 1)), key(&module(8, "renamed", 1)));
+        assert_ne!(key(&module(0, "main", 1)), key(&module(0, "main", 64)));
+
+        let words = module(0, "main", 1);
+        assert_ne!(
+            key(&words),
+            CompileKey::new(
+                &words,
+                None,
+                "main",
+                ShaderStage::Compute,
+                ValidatorVersion::None,
+                &RuntimeConfig::default(),
+            )
+        );
+    }
+}
@@ -0,0 +1,331 @@
+use crate::cache::CompileKey;
+use crate::{
+    DxilObject, RuntimeConfig, ShaderStage, Specialization, SpirvToDxilError, ValidatorVersion,
+};
+use std::collections::{BTreeMap, HashMap};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+
+type SharedResult = Result<Arc<DxilObject>, SpirvToDxilError>;
+
+/// A compile that is in flight on another thread.
+struct Pending {
+    result: Mutex<Option<SharedResult>>,
+    ready: Condvar,
+}
+
+impl Pending {
+    fn wait(&self) -> SharedResult {
+        let mut result = self.result.lock().unwrap();
+        loop {
+            if let Some(result) = &*result {
+                return result.clone();
+            }
+            result = self.ready.wait(result).unwrap();
+        }
+    }
+}
+
+enum Slot {
+    Ready {
+        object: Arc<DxilObject>,
+        last_used: u64,
+    },
+    Pending(Arc<Pending>),
+}
+
+#[derive(Default)]
+struct State {
+    slots: HashMap<CompileKey, Slot>,
+    /// Ready entries ordered from least to most recently used.
+    lru: BTreeMap<u64, CompileKey>,
+    tick: u64,
+    size: usize,
+}
+
+/// Hit, miss and eviction counters for a [`CompileCache`].
+#[derive(Debug, Default, Copy, Clone, PartialEq, Eq)]
+pub struct CompileCacheStats {
+    /// Lookups served from the cache, including those that waited on an in-flight compile.
+    pub hits: u64,
+    /// Lookups that had to compile the shader.
+    pub misses: u64,
+    /// Entries evicted to stay under the size limit.
+    pub evictions: u64,
+}
+
+/// A bounded in-memory cache of compiled DXIL.
+///
+/// Concurrent requests for the same [`CompileKey`] are deduplicated: the first caller compiles
+/// the shader while the others block until its result is available. Compiled objects are shared
+/// between callers through an [`Arc`]. Failed compiles are returned to every waiting caller but
+/// are not cached.
+///
+/// Once the total size of cached blobs exceeds the limit, the least recently used entries are
+/// evicted.
+pub struct CompileCache {
+    state: Mutex<State>,
+    max_size: usize,
+    hits: AtomicU64,
+    misses: AtomicU64,
+    evictions: AtomicU64,
+}
+
+/// Completes a pending slot when dropped, so waiters are released even if the compile panics.
+struct PendingGuard<'a> {
+    cache: &'a CompileCache,
+    key: CompileKey,
+    pending: Arc<Pending>,
+    result: Option<SharedResult>,
+}
+
+impl Drop for PendingGuard<'_> {
+    fn drop(&mut self) {
+        let result = self.result.take().unwrap_or_else(|| {
+            Err(SpirvToDxilError::CompilerError(String::from(
+                "compilation panicked",
+            )))
+        });
+
+        self.cache.complete(self.key, &result);
+
+        *self.pending.result.lock().unwrap() = Some(result);
+        self.pending.ready.notify_all();
+    }
+}
+
+impl CompileCache {
+    /// Create a cache holding at most `max_size` bytes of compiled DXIL.
+    pub fn new(max_size: usize) -> Self {
+        Self {
+            state: Mutex::new(State::default()),
+            max_size,
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+            evictions: AtomicU64::new(0),
+        }
+    }
+
+    /// Get the hit, miss and eviction counters of the cache.
+    pub fn stats(&self) -> CompileCacheStats {
+        CompileCacheStats {
+            hits: self.hits.load(Ordering::Relaxed),
+            misses: self.misses.load(Ordering::Relaxed),
+            evictions: self.evictions.load(Ordering::Relaxed),
+        }
+    }
+
+    /// Look up a compile result, or compile it with `compile` if it is not cached.
+    pub fn get_or_compile(
+        &self,
+        key: CompileKey,
+        compile: impl FnOnce() -> Result<DxilObject, SpirvToDxilError>,
+    ) -> Result<Arc<DxilObject>, SpirvToDxilError> {
+        let (pending, leader) = {
+            let mut state = self.state.lock().unwrap();
+            let state = &mut *state;
+            state.tick += 1;
+            let tick = state.tick;
+
+            match state.slots.get_mut(&key) {
+                Some(Slot::Ready { object, last_used }) => {
+                    state.lru.remove(last_used);
+                    state.lru.insert(tick, key);
+                    *last_used = tick;
+
+                    self.hits.fetch_add(1, Ordering::Relaxed);
+                    return Ok(Arc::clone(object));
+                }
+                Some(Slot::Pending(pending)) => (Arc::clone(pending), false),
+                None => {
+                    let pending = Arc::new(Pending {
+                        result: Mutex::new(None),
+                        ready: Condvar::new(),
+                    });
+                    state.slots.insert(key, Slot::Pending(Arc::clone(&pending)));
+                    (pending, true)
+                }
+            }
+        };
+
+        if !leader {
+            self.hits.fetch_add(1, Ordering::Relaxed);
+            return pending.wait();
+        }
+
+        self.misses.fetch_add(1, Ordering::Relaxed);
+
+        let mut guard = PendingGuard {
+            cache: self,
+            key,
+            pending,
+            result: None,
+        };
+
+        let result = compile().map(Arc::new);
+        guard.result = Some(result.clone());
+        result
+    }
+
+    /// Replace the pending slot for `key` with its result, then evict down to the size limit.
+    fn complete(&self, key: CompileKey, result: &SharedResult) {
+        let mut state = self.state.lock().unwrap();
+        let state = &mut *state;
+
+        let Ok(object) = result else {
+            state.slots.remove(&key);
+            return;
+        };
+
+        state.tick += 1;
+        let tick = state.tick;
+        state.size += object.len();
+        state.lru.insert(tick, key);
+        state.slots.insert(
+            key,
+            Slot::Ready {
+                object: Arc::clone(object),
+                last_used: tick,
+            },
+        );
+
+        while state.size > self.max_size {
+            let Some((_, evicted)) = state.lru.pop_first() else {
+                break;
+            };
+
+            if let Some(Slot::Ready { object, .. }) = state.slots.remove(&evicted) {
+                state.size -= object.len();
+                self.evictions.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+    }
+
+    /// Compile SPIR-V words to a DXIL blob, returning a cached result if one exists.
+    ///
+    /// See [`spirv_to_dxil`](crate::spirv_to_dxil) for details on the parameters.
+    pub fn spirv_to_dxil(
+        &self,
+        spirv_words: &[u32],
+        specializations: Option<&[Specialization]>,
+        entry_point: impl AsRef<str>,
+        stage: ShaderStage,
+        validator_version_max: ValidatorVersion,
+        runtime_conf: &RuntimeConfig,
+    ) -> Result<Arc<DxilObject>, SpirvToDxilError> {
+        let key = CompileKey::new(
+            spirv_words,
+            specializations,
+            entry_point.as_ref(),
+            stage,
+            validator_version_max,
+            runtime_conf,
+        );
+
+        self.get_or_compile(key, || {
+            crate::spirv_to_dxil(
+                spirv_words,
+                specializations,
+                entry_point,
+                stage,
+                validator_version_max,
+                runtime_conf,
+            )
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_compile_cache() {
+        let fragment: &[u8] = include_bytes!("../../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment: &[u32] = bytemuck::cast_slice(&fragment);
+
+        let cache = CompileCache::new(64 * 1024 * 1024);
+        let runtime_conf = RuntimeConfig::default();
+
+        let results: Vec<_> = std::thread::scope(|scope| {
+            let threads: Vec<_> = (0..4)
+                .map(|_| {
+                    scope.spawn(|| {
+                        cache
+                            .spirv_to_dxil(
+                                fragment,
+                                None,
+                                "main",
+                                ShaderStage::Fragment,
+                                ValidatorVersion::None,
+                                &runtime_conf,
+                            )
+                            .expect("failed to compile")
+                    })
+                })
+                .collect();
+
+            threads.into_iter().map(|t| t.join().unwrap()).collect()
+        });
+
+        for result in &results[1..] {
+            assert!(Arc::ptr_eq(&results[0], result));
+        }
+
+        let stats = cache.stats();
+        assert_eq!(stats.misses, 1);
+        assert_eq!(stats.hits, 3);
+        assert_eq!(stats.evictions, 0);
+    }
+
+    #[test]
+    fn test_compile_cache_eviction() {
+        let cache = CompileCache::new(300);
+        let key = |i: u8| CompileKey::from_bytes([i; 16]);
+        let object = || {
+            Ok(DxilObject::from_owned(
+                vec![0; 100].into_boxed_slice(),
+                false,
+            ))
+        };
+        let cached = || -> Result<DxilObject, SpirvToDxilError> { panic!("entry was not cached") };
+
+        for i in 1..=3 {
+            cache.get_or_compile(key(i), object).unwrap();
+        }
+
+        // Using 1 leaves 2 as the least recently used entry, which 4 evicts.
+        cache.get_or_compile(key(1), cached).unwrap();
+        cache.get_or_compile(key(4), object).unwrap();
+        cache.get_or_compile(key(1), cached).unwrap();
+        cache.get_or_compile(key(4), cached).unwrap();
+
+        // 2 is compiled again, which evicts 3.
+        let mut compiled = false;
+        cache
+            .get_or_compile(key(2), || {
+                compiled = true;
+                object()
+            })
+            .unwrap();
+        assert!(compiled);
+        cache.get_or_compile(key(2), cached).unwrap();
+
+        let state = cache.state.lock().unwrap();
+        assert_eq!(state.size, 300);
+        let mut keys: Vec<_> = state.lru.values().copied().collect();
+        keys.sort_unstable();
+        assert_eq!(keys, [key(1), key(2), key(4)]);
+        drop(state);
+
+        assert_eq!(
+            cache.stats(),
+            CompileCacheStats {
+                hits: 4,
+                misses: 5,
+                evictions: 2,
+            }
+        );
+    }
+}
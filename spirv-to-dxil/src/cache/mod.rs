@@ -0,0 +1,18 @@
+//! Caches for compiled DXIL.
+//!
+//! Compile results are identified by a [`CompileKey`], a content hash of every input to
+//! [`spirv_to_dxil`](crate::spirv_to_dxil).
+//!
+//! * [`DiskCache`] persists compiled blobs across runs, such as in an offline shader build.
+//! * [`CompileCache`] is a bounded in-process cache for translating shaders at runtime.
+//! * [`ShaderArchive`] packs many compiled blobs into a single indexed file to ship with an
+//!   application, and reads them back in place.
+mod archive;
+mod disk;
+mod key;
+mod memory;
+
+pub use archive::{ArchiveEntry, ShaderArchive, ShaderArchiveWriter};
+pub use disk::DiskCache;
+pub use key::CompileKey;
+pub use memory::{CompileCache, CompileCacheStats};
@@ -0,0 +1,290 @@
+use crate::SpirvToDxilError;
+use std::fmt;
+
+const DXBC_MAGIC: &[u8; 4] = b"DXBC";
+/// Magic, digest, version, file length and part count.
+const HEADER_SIZE: usize = 32;
+/// Part fourCC and size.
+const PART_HEADER_SIZE: usize = 8;
+
+/// A four character code identifying a part of a DXIL container.
+#[derive(Copy, Clone, PartialEq, Eq, Hash)]
+pub struct FourCC(pub [u8; 4]);
+
+impl FourCC {
+    /// Input signature.
+    pub const ISG1: FourCC = FourCC(*b"ISG1");
+    /// Output signature.
+    pub const OSG1: FourCC = FourCC(*b"OSG1");
+    /// Patch constant signature.
+    pub const PSG1: FourCC = FourCC(*b"PSG1");
+    /// Pipeline state validation data.
+    pub const PSV0: FourCC = FourCC(*b"PSV0");
+    /// Shader statistics.
+    pub const STAT: FourCC = FourCC(*b"STAT");
+    /// Shader hash.
+    pub const HASH: FourCC = FourCC(*b"HASH");
+    /// Runtime data.
+    pub const RDAT: FourCC = FourCC(*b"RDAT");
+    /// Shader feature info.
+    pub const SFI0: FourCC = FourCC(*b"SFI0");
+    /// DXIL program.
+    pub const DXIL: FourCC = FourCC(*b"DXIL");
+
+    /// Slot of the parts that spirv-to-dxil writes in the index of a [`DxilContainer`].
+    fn slot(self) -> Option<usize> {
+        Some(match self {
+            FourCC::ISG1 => 0,
+            FourCC::OSG1 => 1,
+            FourCC::PSG1 => 2,
+            FourCC::PSV0 => 3,
+            FourCC::STAT => 4,
+            FourCC::HASH => 5,
+            FourCC::RDAT => 6,
+            FourCC::SFI0 => 7,
+            FourCC::DXIL => 8,
+            _ => return None,
+        })
+    }
+}
+
+const INDEXED_PARTS: usize = 9;
+
+impl fmt::Debug for FourCC {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "FourCC({})", self)
+    }
+}
+
+impl fmt::Display for FourCC {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        for &byte in &self.0 {
+            if byte.is_ascii_graphic() {
+                write!(f, "{}", byte as char)?;
+            } else {
+                write!(f, "\\x{byte:02x}")?;
+            }
+        }
+        Ok(())
+    }
+}
+
+/// A part of a [`DxilContainer`].
+#[derive(Debug, Copy, Clone)]
+pub struct DxilPart<'a> {
+    /// The kind of the part.
+    pub fourcc: FourCC,
+    /// The contents of the part, after its header.
+    pub data: &'a [u8],
+}
+
+/// A read-only view of a DXIL container, as written by spirv-to-dxil.
+///
+/// The container header and part table are validated once when the view is created, and parts
+/// are then read in place without copying. Parts that spirv-to-dxil emits, such as
+/// [`PSV0`](FourCC::PSV0) or [`DXIL`](FourCC::DXIL), are indexed by fourCC so that
+/// [`part`](DxilContainer::part) finds them in constant time.
+#[derive(Clone)]
+pub struct DxilContainer<'a> {
+    bytes: &'a [u8],
+    /// The part offset table.
+    offsets: &'a [u8],
+    /// The index of the first part of each indexed kind, or `u32::MAX` if absent.
+    index: [u32; INDEXED_PARTS],
+}
+
+fn read_u16(bytes: &[u8], offset: usize) -> u16 {
+    u16::from_le_bytes(bytes[offset..offset + 2].try_into().unwrap())
+}
+
+fn read_u32(bytes: &[u8], offset: usize) -> u32 {
+    u32::from_le_bytes(bytes[offset..offset + 4].try_into().unwrap())
+}
+
+impl<'a> DxilContainer<'a> {
+    /// Parse the header and part table of a DXIL container.
+    pub fn new(bytes: &'a [u8]) -> Result<Self, SpirvToDxilError> {
+        if bytes.len() < HEADER_SIZE || &bytes[..4] != DXBC_MAGIC {
+            return Err(SpirvToDxilError::InvalidContainer("missing DXBC header"));
+        }
+
+        if read_u32(bytes, 24) as usize != bytes.len() {
+            return Err(SpirvToDxilError::InvalidContainer(
+                "file length does not match the container size",
+            ));
+        }
+
+        let part_count = read_u32(bytes, 28) as usize;
+        let Some(offsets) = part_count
+            .checked_mul(4)
+            .and_then(|size| bytes.get(HEADER_SIZE..HEADER_SIZE.checked_add(size)?))
+        else {
+            return Err(SpirvToDxilError::InvalidContainer(
+                "part offset table out of bounds",
+            ));
+        };
+
+        let mut container = Self {
+            bytes,
+            offsets,
+            index: [u32::MAX; INDEXED_PARTS],
+        };
+
+        for part in 0..part_count {
+            let offset = read_u32(offsets, part * 4) as usize;
+            let Some(header) = bytes.get(offset..offset.saturating_add(PART_HEADER_SIZE)) else {
+                return Err(SpirvToDxilError::InvalidContainer("part out of bounds"));
+            };
+
+            let size = read_u32(header, 4) as usize;
+            if bytes.len() - offset - PART_HEADER_SIZE < size {
+                return Err(SpirvToDxilError::InvalidContainer("part out of bounds"));
+            }
+
+            let fourcc = FourCC(header[..4].try_into().unwrap());
+            if let Some(slot) = fourcc.slot() {
+                if container.index[slot] == u32::MAX {
+                    container.index[slot] = part as u32;
+                }
+            }
+        }
+
+        Ok(container)
+    }
+
+    /// The bytes of the whole container.
+    pub fn as_bytes(&self) -> &'a [u8] {
+        self.bytes
+    }
+
+    /// The signature stored in the container header.
+    pub fn digest(&self) -> &'a [u8; 16] {
+        self.bytes[4..20].try_into().unwrap()
+    }
+
+    /// The container format version, as `(major, minor)`.
+    pub fn version(&self) -> (u16, u16) {
+        (read_u16(self.bytes, 20), read_u16(self.bytes, 22))
+    }
+
+    /// The number of parts in the container.
+    pub fn part_count(&self) -> usize {
+        self.offsets.len() / 4
+    }
+
+    /// The part at `index` in the part table.
+    pub fn part_at(&self, index: usize) -> Option<DxilPart<'a>> {
+        if index >= self.part_count() {
+            return None;
+        }
+
+        // Bounds were checked when the container was parsed.
+        let offset = read_u32(self.offsets, index * 4) as usize;
+        let size = read_u32(self.bytes, offset + 4) as usize;
+        let data_offset = offset + PART_HEADER_SIZE;
+
+        Some(DxilPart {
+            fourcc: FourCC(self.bytes[offset..offset + 4].try_into().unwrap()),
+            data: &self.bytes[data_offset..data_offset + size],
+        })
+    }
+
+    /// Find the first part of the given kind.
+    ///
+    /// Parts that spirv-to-dxil emits are found in constant time. Other kinds fall back to a
+    /// scan of the part table.
+    pub fn part(&self, fourcc: FourCC) -> Option<DxilPart<'a>> {
+        match fourcc.slot() {
+            Some(slot) => self.part_at(self.index[slot] as usize),
+            None => self.parts().find(|part| part.fourcc == fourcc),
+        }
+    }
+
+    /// Iterate over the parts in the order of the part table.
+    pub fn parts(&self) -> impl ExactSizeIterator<Item = DxilPart<'a>> + '_ {
+        (0..self.part_count()).map(|index| self.part_at(index).unwrap())
+    }
+}
+
+impl fmt::Debug for DxilContainer<'_> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("DxilContainer")
+            .field("version", &self.version())
+            .field(
+                "parts",
+                &self
+                    .parts()
+                    .map(|part| (part.fourcc, part.data.len()))
+                    .collect::<Vec<_>>(),
+            )
+            .finish()
+    }
+}
+
+#[cfg(test)]
+/// Assemble a container from its parts.
+pub(crate) fn assemble(parts: &[(FourCC, &[u8])]) -> Vec<u8> {
+    let mut bytes = Vec::from(*DXBC_MAGIC);
+    bytes.extend_from_slice(&[0; 16]);
+    bytes.extend_from_slice(&1u16.to_le_bytes());
+    bytes.extend_from_slice(&0u16.to_le_bytes());
+    bytes.extend_from_slice(&0u32.to_le_bytes());
+    bytes.extend_from_slice(&(parts.len() as u32).to_le_bytes());
+
+    let mut offset = HEADER_SIZE + parts.len() * 4;
+    for (_, data) in parts {
+        bytes.extend_from_slice(&(offset as u32).to_le_bytes());
+        offset += PART_HEADER_SIZE + data.len();
+    }
+    for (fourcc, data) in parts {
+        bytes.extend_from_slice(&fourcc.0);
+        bytes.extend_from_slice(&(data.len() as u32).to_le_bytes());
+        bytes.extend_from_slice(data);
+    }
+
+    let len = bytes.len() as u32;
+    bytes[24..28].copy_from_slice(&len.to_le_bytes());
+    bytes
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_container_parts() {
+        let unknown = FourCC(*b"XYZ0");
+        let bytes = assemble(&[
+            (FourCC::SFI0, &[1; 8]),
+            (FourCC::PSV0, &[2; 52]),
+            (unknown, &[3; 4]),
+            (FourCC::DXIL, &[4; 12]),
+        ]);
+
+        let container = DxilContainer::new(&bytes).expect("failed to parse container");
+        assert_eq!(container.version(), (1, 0));
+        assert_eq!(container.part_count(), 4);
+        assert_eq!(container.part(FourCC::PSV0).unwrap().data, &[2; 52]);
+        assert_eq!(container.part(FourCC::DXIL).unwrap().data, &[4; 12]);
+        assert_eq!(container.part(unknown).unwrap().data, &[3; 4]);
+        assert!(container.part(FourCC::ISG1).is_none());
+
+        let fourccs: Vec<FourCC> = container.parts().map(|part| part.fourcc).collect();
+        assert_eq!(fourccs, [FourCC::SFI0, FourCC::PSV0, unknown, FourCC::DXIL]);
+    }
+
+    #[test]
+    fn test_container_invalid() {
+        let bytes = assemble(&[(FourCC::DXIL, &[4; 12])]);
+
+        assert!(DxilContainer::new(&bytes[..bytes.len() - 1]).is_err());
+
+        let mut truncated = bytes.clone();
+        truncated[40..44].copy_from_slice(&13u32.to_le_bytes());
+        assert!(DxilContainer::new(&truncated).is_err());
+
+        let mut overflow = bytes.clone();
+        overflow[28..32].copy_from_slice(&u32::MAX.to_le_bytes());
+        assert!(DxilContainer::new(&overflow).is_err());
+    }
+}
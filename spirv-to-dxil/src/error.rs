@@ -1,6 +1,6 @@
 use thiserror::Error;
 
-#[derive(Debug, Error)]
+#[derive(Debug, Clone, Error)]
 /// Error type for spirv-to-dxil.
 pub enum SpirvToDxilError {
     /// An error occurred when compiling SPIR-V to DXIL.
@@ -10,4 +10,13 @@ pub enum SpirvToDxilError {
     /// the limit of 31.
     #[error("Register space {0} is beyond the limit of 31.")]
     RegisterSpaceOverflow(u32),
+    /// The input is not a well-formed SPIR-V module.
+    #[error("Invalid SPIR-V module: {0}.")]
+    InvalidSpirv(&'static str),
+    /// The input is not a well-formed DXIL container.
+    #[error("Invalid DXIL container: {0}.")]
+    InvalidContainer(&'static str),
+    /// The input is not a well-formed shader archive.
+    #[error("Invalid shader archive: {0}.")]
+    InvalidArchive(&'static str),
 }
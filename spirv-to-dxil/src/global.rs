@@ -0,0 +1,113 @@
+use crate::{CompileOptions, RuntimeConfig, ShaderStage, ValidatorVersion};
+use std::sync::Mutex;
+
+/// Keeps Mesa's `glsl_types` cache alive while held.
+///
+/// Every compile takes and drops its own reference to the cache. Without an outstanding
+/// reference, the cache is torn down whenever no compile happens to be running and rebuilt by the
+/// next one, which interns every type again while holding the cache's global lock.
+///
+/// Holding a reference only keeps the interned types alive. Every lookup still takes the lock.
+struct TypeCacheRef(());
+
+impl TypeCacheRef {
+    fn new() -> Self {
+        unsafe { spirv_to_dxil_sys::glsl_type_singleton_init_or_ref() };
+        TypeCacheRef(())
+    }
+}
+
+impl Drop for TypeCacheRef {
+    fn drop(&mut self) {
+        unsafe { spirv_to_dxil_sys::glsl_type_singleton_decref() };
+    }
+}
+
+/// The reference held between [`initialize`] and [`shutdown`].
+static TYPE_CACHE: Mutex<Option<TypeCacheRef>> = Mutex::new(None);
+
+/// An empty `local_size(1, 1, 1)` compute shader named `main`.
+#[rustfmt::skip]
+const WARMUP_SHADER: &[u32] = &[
+    0x07230203, 0x00010000, 0, 5, 0,
+    // OpCapability Shader
+    0x00020011, 1,
+    // OpMemoryModel Logical GLSL450
+    0x0003000e, 0, 1,
+    // OpEntryPoint GLCompute %1 "main"
+    0x0005000f, 5, 1, u32::from_le_bytes(*b"main"), 0,
+    // OpExecutionMode %1 LocalSize 1 1 1
+    0x00060010, 1, 17, 1, 1, 1,
+    // %2 = OpTypeVoid
+    0x00020013, 2,
+    // %3 = OpTypeFunction %2
+    0x00030021, 3, 2,
+    // %1 = OpFunction %2 None %3
+    0x00050036, 2, 1, 0, 3,
+    // %4 = OpLabel
+    0x000200f8, 4,
+    // OpReturn
+    0x000100fd,
+    // OpFunctionEnd
+    0x00010038,
+];
+
+/// Perform the one-time setup of the native compiler ahead of the first compile.
+///
+/// The first compile in a process otherwise pays for creating the `glsl_types` cache and its
+/// builtin types, running Mesa's one-time initializers, and faulting in the compiler's code and
+/// opcode tables. This does that work up front by compiling an empty shader, and keeps the
+/// `glsl_types` cache alive until [`shutdown`], so that it is not torn down and rebuilt between
+/// compiles.
+///
+/// Calling this more than once has no further effect until [`shutdown`] is called.
+pub fn initialize() {
+    let Ok(mut type_cache) = TYPE_CACHE.lock() else {
+        return;
+    };
+
+    if type_cache.is_some() {
+        return;
+    }
+    *type_cache = Some(TypeCacheRef::new());
+
+    let warmup = crate::spirv_to_dxil_with_options(
+        WARMUP_SHADER,
+        None,
+        "main",
+        ShaderStage::Compute,
+        ValidatorVersion::None,
+        &RuntimeConfig::default(),
+        &CompileOptions::default(),
+    );
+    debug_assert!(warmup.is_ok(), "failed to compile the warm-up shader");
+}
+
+/// Release the state kept alive by [`initialize`].
+///
+/// The `glsl_types` cache is freed once no compile is using it, and with the `arena` feature,
+/// arena chunks kept for reuse are returned to the allocator. Compiling after this is still
+/// allowed, and sets the state up again on demand.
+pub fn shutdown() {
+    if let Ok(mut type_cache) = TYPE_CACHE.lock() {
+        type_cache.take();
+    }
+
+    #[cfg(feature = "arena")]
+    spirv_to_dxil_sys::alloc::trim();
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::SpirvModule;
+
+    #[test]
+    fn test_warmup_shader() {
+        let module = SpirvModule::new(WARMUP_SHADER).expect("failed to parse warm-up shader");
+        let entry_point = module
+            .entry_point("main", Some(ShaderStage::Compute))
+            .expect("missing entry point");
+        assert_eq!(entry_point.name(), "main");
+    }
+}
@@ -16,22 +16,104 @@
 //! [RuntimeDataBufferConfig](crate::RuntimeDataBufferConfig).
 //!
 //! See the [`runtime`](crate::runtime) module for how to construct the expected runtime data to be bound in a constant buffer.
+//!
+//! ## Thread Safety
+//! [`spirv_to_dxil`](crate::spirv_to_dxil) may be called concurrently from any number of threads.
+//! The only process-wide state Mesa touches during a compile is the `glsl_types` singleton, which is
+//! reference counted and whose type tables are guarded by a mutex, and one-time initializers run
+//! through `u_call_once`, which is backed by `call_once`. Everything else is allocated per compile.
+//! Every type lookup takes the `glsl_types` mutex, so compiles on many threads contend on it.
+//! [`initialize`](crate::initialize) keeps the cache alive so that it is not rebuilt between
+//! compiles, but does not reduce that contention.
+//!
+//! To compile many shaders at once, see [`spirv_to_dxil_batch`](crate::spirv_to_dxil_batch). To compile
+//! several entry points of the same module, see [`SpirvModule`](crate::SpirvModule).
+//!
+//! ## Memory Allocation
+//! By default, Mesa allocates from the C library heap. With the `allocator` feature, its
+//! allocations go through the Rust global allocator instead, so a `#[global_allocator]` such as a
+//! thread-caching allocator applies to the native compiler too. Another allocator can be installed
+//! with [`set_allocator`](crate::set_allocator) before the first compile.
+//!
+//! With the `arena` feature, [`CompileOptions::arena`](crate::CompileOptions::arena) serves the
+//! compiler's many small allocations from a per-thread bump arena, which avoids contending on the
+//! system allocator when compiling in parallel.
+//!
+//! ## Compile Latency
+//! spirv-to-dxil always runs its full NIR optimization loop before emitting DXIL, and does not
+//! expose a faster optimization level. `nir_to_dxil` relies on that loop to fold constants and
+//! remove dead derefs and variables before it lowers resources, so a shortened pipeline can emit
+//! DXIL that fails validation.
+//!
+//! For latency-sensitive workflows such as hot-reloading, avoid recompiling unchanged shaders
+//! with a [`CompileCache`](crate::cache::CompileCache), and compile
+//! the shaders that did change together with [`spirv_to_dxil_batch`](crate::spirv_to_dxil_batch).
+//!
+//! The first compile in a process also pays for one-time setup in Mesa. Call
+//! [`initialize`](crate::initialize) at startup, for example on a loading screen, to move that
+//! cost off the first compile.
+//!
+//! ## Profiling
+//! With the `profile` feature, [`CompileOptions::profile_passes`](crate::CompileOptions::profile_passes)
+//! records how many times each NIR pass ran, how often it made progress, and how long it took,
+//! which shows the passes that iterate the most on a pathological shader. See
+//! [`DxilObject::passes`](crate::DxilObject::passes).
+//!
+//! ## Caching
+//! Compile results can be persisted across runs with [`DiskCache`](crate::cache::DiskCache), or
+//! shared in memory between callers with [`CompileCache`](crate::cache::CompileCache).
+//! To ship precompiled shaders, pack them into a single file with
+//! [`ShaderArchiveWriter`](crate::cache::ShaderArchiveWriter) and read them back in place,
+//! for example from a memory-mapped file, with [`ShaderArchive`](crate::cache::ShaderArchive).
+mod batch;
+pub mod cache;
+mod container;
 mod ctypes;
 mod error;
+mod global;
 mod logger;
+mod module;
 mod object;
+mod options;
+mod reflection;
 pub mod runtime;
 mod specialization;
+mod strip;
 
+pub use crate::batch::CompileJob;
 pub use crate::error::SpirvToDxilError;
+pub use crate::global::{initialize, shutdown};
+pub use container::{DxilContainer, DxilPart, FourCC};
 pub use ctypes::*;
+pub use module::{EntryPoint, SpecConstant, SpirvModule};
 pub use object::*;
+pub use options::*;
+pub use reflection::*;
 pub use specialization::*;
 pub use spirv_to_dxil_sys::DXIL_SPIRV_MAX_VIEWPORT;
+pub use strip::{strip_dead_code, strip_debug_info, StrippedSpirv};
+
+#[cfg(feature = "allocator")]
+pub use spirv_to_dxil_sys::alloc::set_allocator;
 
 use crate::logger::Logger;
 use spirv_to_dxil_sys::dxil_spirv_object;
+use std::borrow::Cow;
 use std::mem::MaybeUninit;
+use std::time::{Duration, Instant};
+
+fn validate_runtime_conf(runtime_conf: &RuntimeConfig) -> Result<(), SpirvToDxilError> {
+    if runtime_conf.push_constant_cbv.register_space > 31
+        || runtime_conf.runtime_data_cbv.register_space > 31
+    {
+        return Err(SpirvToDxilError::RegisterSpaceOverflow(std::cmp::max(
+            runtime_conf.push_constant_cbv.register_space,
+            runtime_conf.runtime_data_cbv.register_space,
+        )));
+    }
+
+    Ok(())
+}
 
 fn spirv_to_dxil_inner(
     spirv_words: &[u32],
@@ -43,23 +125,22 @@ fn spirv_to_dxil_inner(
     dump_nir: bool,
     logger: &spirv_to_dxil_sys::dxil_spirv_logger,
     out: &mut MaybeUninit<dxil_spirv_object>,
-) -> Result<bool, SpirvToDxilError> {
-    if runtime_conf.push_constant_cbv.register_space > 31
-        || runtime_conf.runtime_data_cbv.register_space > 31
-    {
-        return Err(SpirvToDxilError::RegisterSpaceOverflow(std::cmp::max(
-            runtime_conf.push_constant_cbv.register_space,
-            runtime_conf.runtime_data_cbv.register_space,
-        )));
-    }
+    mut statistics: Option<&mut CompileStatistics>,
+) -> bool {
+    let start = Instant::now();
     let num_specializations = specializations.map(|o| o.len()).unwrap_or(0) as u32;
     let mut specializations: Option<Vec<spirv_to_dxil_sys::dxil_spirv_specialization>> =
         specializations.map(|o| o.into_iter().map(|o| (*o).into()).collect());
 
     let debug = spirv_to_dxil_sys::dxil_spirv_debug_options { dump_nir };
 
-    unsafe {
-        Ok(spirv_to_dxil_sys::spirv_to_dxil(
+    if let Some(statistics) = statistics.as_deref_mut() {
+        statistics.prepare = start.elapsed();
+    }
+    let translate_start = Instant::now();
+
+    let result = unsafe {
+        spirv_to_dxil_sys::spirv_to_dxil(
             spirv_words.as_ptr(),
             spirv_words.len(),
             specializations
@@ -73,8 +154,14 @@ fn spirv_to_dxil_inner(
             runtime_conf,
             logger,
             out.as_mut_ptr(),
-        ))
+        )
+    };
+
+    if let Some(statistics) = statistics {
+        statistics.translate = translate_start.elapsed();
     }
+
+    result
 }
 
 /// Dump the parsed NIR output of the SPIR-V to stdout.
@@ -90,8 +177,10 @@ pub fn dump_nir(
     let mut entry_point = String::from(entry_point).into_bytes();
     entry_point.push(0);
 
+    validate_runtime_conf(runtime_conf)?;
+
     let mut out = MaybeUninit::uninit();
-    spirv_to_dxil_inner(
+    Ok(spirv_to_dxil_inner(
         spirv_words,
         specializations,
         &entry_point,
@@ -101,7 +190,8 @@ pub fn dump_nir(
         true,
         &logger::DEBUG_LOGGER,
         &mut out,
-    )
+        None,
+    ))
 }
 
 /// Compile SPIR-V words to a DXIL blob.
@@ -118,45 +208,254 @@ pub fn spirv_to_dxil(
     stage: ShaderStage,
     validator_version_max: ValidatorVersion,
     runtime_conf: &RuntimeConfig,
+) -> Result<DxilObject, SpirvToDxilError> {
+    spirv_to_dxil_with_options(
+        spirv_words,
+        specializations,
+        entry_point,
+        stage,
+        validator_version_max,
+        runtime_conf,
+        &CompileOptions::default(),
+    )
+}
+
+/// Compile SPIR-V words to a DXIL blob with additional [`CompileOptions`].
+///
+/// See [`spirv_to_dxil`] for details on the other parameters.
+pub fn spirv_to_dxil_with_options(
+    spirv_words: &[u32],
+    specializations: Option<&[Specialization]>,
+    entry_point: impl AsRef<str>,
+    stage: ShaderStage,
+    validator_version_max: ValidatorVersion,
+    runtime_conf: &RuntimeConfig,
+    options: &CompileOptions,
 ) -> Result<DxilObject, SpirvToDxilError> {
     let entry_point = entry_point.as_ref();
     let mut entry_point = String::from(entry_point).into_bytes();
     entry_point.push(0);
 
+    spirv_to_dxil_compile(
+        spirv_words,
+        specializations,
+        &entry_point,
+        stage,
+        validator_version_max,
+        runtime_conf,
+        options,
+    )
+}
+
+/// A module with the stripping requested by [`CompileOptions`] applied for one entry point,
+/// which any number of compiles of that entry point can share.
+struct PreparedSpirv<'a> {
+    words: Cow<'a, [u32]>,
+    words_removed: usize,
+    /// Time spent stripping the module.
+    duration: Duration,
+}
+
+impl<'a> PreparedSpirv<'a> {
+    /// Strip a module for an entry point with a null-terminated name.
+    ///
+    /// A module that cannot be stripped is compiled as is.
+    fn new(
+        spirv_words: &'a [u32],
+        entry_point: &[u8],
+        stage: ShaderStage,
+        options: &CompileOptions,
+    ) -> Self {
+        let start = Instant::now();
+        let mut words = Cow::Borrowed(spirv_words);
+        let mut words_removed = 0;
+
+        // Debug info goes first, so that dead code stripping has less to walk.
+        if options.strip_debug_info {
+            if let Ok(stripped) = strip_debug_info(&words) {
+                words_removed += stripped.words_removed;
+                words = Cow::Owned(stripped.words);
+            }
+        }
+
+        if options.strip_dead_code {
+            let name =
+                std::str::from_utf8(&entry_point[..entry_point.len() - 1]).unwrap_or_default();
+            if let Ok(stripped) = strip_dead_code(&words, name, stage) {
+                words_removed += stripped.words_removed;
+                words = Cow::Owned(stripped.words);
+            }
+        }
+
+        Self {
+            words,
+            words_removed,
+            duration: start.elapsed(),
+        }
+    }
+}
+
+/// Compile SPIR-V words to a DXIL blob with a null-terminated entry point name.
+fn spirv_to_dxil_compile(
+    spirv_words: &[u32],
+    specializations: Option<&[Specialization]>,
+    entry_point: &[u8],
+    stage: ShaderStage,
+    validator_version_max: ValidatorVersion,
+    runtime_conf: &RuntimeConfig,
+    options: &CompileOptions,
+) -> Result<DxilObject, SpirvToDxilError> {
+    validate_runtime_conf(runtime_conf)?;
+
+    let prepared = PreparedSpirv::new(spirv_words, entry_point, stage, options);
+    compile_prepared(
+        &prepared,
+        specializations,
+        entry_point,
+        stage,
+        validator_version_max,
+        runtime_conf,
+        options,
+    )
+}
+
+/// Compile a module prepared by [`PreparedSpirv::new`], with a runtime config that has already
+/// been validated.
+fn compile_prepared(
+    prepared: &PreparedSpirv,
+    specializations: Option<&[Specialization]>,
+    entry_point: &[u8],
+    stage: ShaderStage,
+    validator_version_max: ValidatorVersion,
+    runtime_conf: &RuntimeConfig,
+    options: &CompileOptions,
+) -> Result<DxilObject, SpirvToDxilError> {
+    let start = Instant::now();
+    let mut statistics = options.statistics.then(CompileStatistics::default);
+    if let Some(statistics) = statistics.as_mut() {
+        statistics.words_removed = prepared.words_removed;
+    }
+
+    #[cfg(feature = "arena")]
+    let arena = options
+        .arena
+        .then(spirv_to_dxil_sys::alloc::ArenaScope::enter);
+
+    #[cfg(feature = "allocator")]
+    let memory = options
+        .statistics
+        .then(spirv_to_dxil_sys::alloc::MemoryScope::enter);
+
+    #[cfg(feature = "profile")]
+    let profile = (options.statistics || options.profile_passes)
+        .then(spirv_to_dxil_sys::profile::ProfileScope::enter);
+
     let logger = Logger::new();
     let logger = logger.into_logger();
     let mut out = MaybeUninit::uninit();
 
     let result = spirv_to_dxil_inner(
-        spirv_words,
+        &prepared.words,
         specializations,
-        &entry_point,
+        entry_point,
         stage,
         validator_version_max,
         runtime_conf,
         false,
         &logger,
         &mut out,
-    )?;
+        statistics.as_mut(),
+    );
+
+    if let Some(statistics) = statistics.as_mut() {
+        statistics.prepare += prepared.duration;
+    }
+
+    #[cfg(feature = "profile")]
+    let passes = profile
+        .map(spirv_to_dxil_sys::profile::ProfileScope::finish)
+        .and_then(|profile| {
+            if let Some(statistics) = statistics.as_mut() {
+                statistics.parse = profile.parse;
+                statistics.lower = profile.lower;
+                statistics.optimize = profile.optimize;
+                statistics.emit = profile.emit;
+                statistics.container = profile.container;
+            }
+
+            options
+                .profile_passes
+                .then(|| profile.passes.into_iter().map(PassProfile::from).collect())
+        });
+    #[cfg(not(feature = "profile"))]
+    let passes = None;
 
     let logger = unsafe { Logger::finalize(logger) };
 
+    #[cfg(feature = "allocator")]
+    if let Some(usage) = memory.map(spirv_to_dxil_sys::alloc::MemoryScope::finish) {
+        if let Some(statistics) = statistics.as_mut() {
+            statistics.peak_memory = usage.peak_bytes;
+            statistics.allocations = usage.allocations;
+        }
+    }
+
     if result {
         let out = unsafe { out.assume_init() };
 
         if validator_version_max == ValidatorVersion::None {
+            let sign_start = Instant::now();
+
             let size = out.binary.size;
             let blob =
                 unsafe { ::core::slice::from_raw_parts_mut(out.binary.buffer as *mut u8, size) };
             mach_siegbert_vogt_dxcsa::sign_in_place(blob);
+
+            if let Some(statistics) = statistics.as_mut() {
+                statistics.sign = sign_start.elapsed();
+            }
         }
 
-        Ok(DxilObject::new(out))
+        if let Some(statistics) = statistics.as_mut() {
+            statistics.total = start.elapsed() + prepared.duration;
+        }
+
+        let object = DxilObject::new(out)
+            .with_statistics(statistics)
+            .with_passes(passes);
+
+        // Free the output buffer while the arena is still active, so that the arena can be
+        // rewound for the next compile.
+        #[cfg(feature = "arena")]
+        if arena.is_some() {
+            return Ok(object.into_owned());
+        }
+
+        Ok(object)
     } else {
         Err(SpirvToDxilError::CompilerError(logger))
     }
 }
 
+/// Compile a batch of SPIR-V modules to DXIL blobs in parallel.
+///
+/// Jobs are distributed over a pool of scoped worker threads sized to the available parallelism.
+/// One result is returned per job, in the same order as `jobs`.
+///
+/// See [`spirv_to_dxil`] for how `validator_version_max` affects the output of each job.
+pub fn spirv_to_dxil_batch(jobs: &[CompileJob]) -> Vec<Result<DxilObject, SpirvToDxilError>> {
+    batch::parallel_map(jobs, |job| {
+        spirv_to_dxil(
+            job.spirv_words,
+            job.specializations,
+            job.entry_point,
+            job.stage,
+            job.validator_version_max,
+            job.runtime_conf,
+        )
+    })
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -222,4 +521,285 @@ mod tests {
         )
         .expect("failed to compile");
     }
+
+    #[test]
+    fn test_statistics() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment = bytemuck::cast_slice(&fragment);
+
+        let object = super::spirv_to_dxil_with_options(
+            &fragment,
+            None,
+            "main",
+            ShaderStage::Fragment,
+            ValidatorVersion::None,
+            &RuntimeConfig::default(),
+            &CompileOptions {
+                statistics: true,
+                ..CompileOptions::default()
+            },
+        )
+        .expect("failed to compile");
+
+        let statistics = object.statistics().expect("statistics were not collected");
+        assert!(statistics.translate > statistics.sign);
+        assert!(statistics.total >= statistics.prepare + statistics.translate + statistics.sign);
+
+        #[cfg(feature = "allocator")]
+        {
+            assert!(statistics.allocations > 0);
+            assert!(statistics.peak_memory > 0);
+        }
+
+        #[cfg(feature = "profile")]
+        {
+            assert!(!statistics.parse.is_zero());
+            assert!(!statistics.emit.is_zero());
+            assert!(!statistics.container.is_zero());
+            assert!(
+                statistics.parse
+                    + statistics.lower
+                    + statistics.optimize
+                    + statistics.emit
+                    + statistics.container
+                    <= statistics.translate
+            );
+        }
+    }
+
+    #[test]
+    fn test_profile_passes() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment = bytemuck::cast_slice(&fragment);
+
+        let object = super::spirv_to_dxil_with_options(
+            &fragment,
+            None,
+            "main",
+            ShaderStage::Fragment,
+            ValidatorVersion::None,
+            &RuntimeConfig::default(),
+            &CompileOptions {
+                profile_passes: true,
+                ..CompileOptions::default()
+            },
+        )
+        .expect("failed to compile");
+
+        assert!(object.statistics().is_none());
+
+        #[cfg(feature = "profile")]
+        {
+            let passes = object.passes().expect("passes were not profiled");
+            assert!(passes.iter().any(|pass| pass.name == "nir_opt_algebraic"));
+            for pass in passes {
+                assert!(pass.invocations > 0);
+                assert!(pass.progress <= pass.invocations);
+            }
+        }
+
+        #[cfg(not(feature = "profile"))]
+        assert!(object.passes().is_none());
+    }
+
+    #[test]
+    fn test_strip_dead_code() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment = bytemuck::cast_slice(&fragment);
+
+        let object = super::spirv_to_dxil_with_options(
+            fragment,
+            None,
+            "main",
+            ShaderStage::Fragment,
+            ValidatorVersion::None,
+            &RuntimeConfig::default(),
+            &CompileOptions {
+                statistics: true,
+                strip_dead_code: true,
+                ..CompileOptions::default()
+            },
+        )
+        .expect("failed to compile");
+
+        let stripped = super::strip_dead_code(fragment, "main", ShaderStage::Fragment)
+            .expect("failed to strip");
+        let statistics = object.statistics().expect("statistics were not collected");
+        assert_eq!(statistics.words_removed, stripped.words_removed);
+    }
+
+    #[test]
+    fn test_strip_debug_info() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment = bytemuck::cast_slice(&fragment);
+
+        let object = spirv_to_dxil_with_options(
+            fragment,
+            None,
+            "main",
+            ShaderStage::Fragment,
+            ValidatorVersion::None,
+            &RuntimeConfig::default(),
+            &CompileOptions {
+                statistics: true,
+                strip_debug_info: true,
+                ..CompileOptions::default()
+            },
+        )
+        .expect("failed to compile");
+
+        let stripped = super::strip_debug_info(fragment).expect("failed to strip");
+        let statistics = object.statistics().expect("statistics were not collected");
+        assert_eq!(statistics.words_removed, stripped.words_removed);
+    }
+
+    #[test]
+    fn test_initialize() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment = bytemuck::cast_slice(&fragment);
+
+        let compile = || {
+            super::spirv_to_dxil(
+                fragment,
+                None,
+                "main",
+                ShaderStage::Fragment,
+                ValidatorVersion::None,
+                &RuntimeConfig::default(),
+            )
+            .expect("failed to compile")
+        };
+
+        super::initialize();
+        super::initialize();
+        let first = compile();
+
+        super::shutdown();
+        super::shutdown();
+        assert_eq!(*first, *compile());
+    }
+
+    #[test]
+    fn test_batch() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment: &[u32] = bytemuck::cast_slice(&fragment);
+
+        let vertex: &[u8] = include_bytes!("../test/vertex.spv");
+        let vertex = Vec::from(vertex);
+        let vertex: &[u32] = bytemuck::cast_slice(&vertex);
+
+        let runtime_conf = RuntimeConfig::default();
+        let jobs: Vec<CompileJob> = (0..8)
+            .map(|i| CompileJob {
+                spirv_words: if i % 2 == 0 { fragment } else { vertex },
+                specializations: None,
+                entry_point: "main",
+                stage: if i % 2 == 0 {
+                    ShaderStage::Fragment
+                } else {
+                    ShaderStage::Vertex
+                },
+                validator_version_max: ValidatorVersion::None,
+                runtime_conf: &runtime_conf,
+            })
+            .collect();
+
+        let results = super::spirv_to_dxil_batch(&jobs);
+        assert_eq!(results.len(), jobs.len());
+
+        for (job, result) in jobs.iter().zip(results) {
+            let single = super::spirv_to_dxil(
+                job.spirv_words,
+                None,
+                "main",
+                job.stage,
+                ValidatorVersion::None,
+                &runtime_conf,
+            )
+            .expect("failed to compile");
+
+            assert_eq!(&*result.expect("failed to compile"), &*single);
+        }
+    }
+
+    #[test]
+    fn test_container() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment = bytemuck::cast_slice(&fragment);
+
+        let object = super::spirv_to_dxil(
+            &fragment,
+            None,
+            "main",
+            ShaderStage::Fragment,
+            ValidatorVersion::None,
+            &RuntimeConfig::default(),
+        )
+        .expect("failed to compile");
+
+        let container = object.container().expect("failed to parse container");
+        assert!(container.part(FourCC::DXIL).is_some());
+        assert!(container.part(FourCC::PSV0).is_some());
+        assert!(mach_siegbert_vogt_dxcsa::verify(container.as_bytes()));
+    }
+
+    #[test]
+    fn test_reflect() {
+        let vertex: &[u8] = include_bytes!("../test/vertex.spv");
+        let vertex = Vec::from(vertex);
+        let vertex = bytemuck::cast_slice(&vertex);
+
+        let object = super::spirv_to_dxil(
+            &vertex,
+            None,
+            "main",
+            ShaderStage::Vertex,
+            ValidatorVersion::None,
+            &RuntimeConfig::default(),
+        )
+        .expect("failed to compile");
+
+        let reflection = object.reflect().expect("failed to reflect");
+        assert!(reflection
+            .outputs
+            .iter()
+            .any(|element| element.semantic_name == "SV_Position"));
+        assert_eq!(reflection.workgroup_size, None);
+    }
+
+    #[cfg(feature = "arena")]
+    #[test]
+    fn test_arena() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment = bytemuck::cast_slice(&fragment);
+
+        let compile = |arena| {
+            super::spirv_to_dxil_with_options(
+                &fragment,
+                None,
+                "main",
+                ShaderStage::Fragment,
+                ValidatorVersion::None,
+                &RuntimeConfig::default(),
+                &CompileOptions {
+                    arena,
+                    ..CompileOptions::default()
+                },
+            )
+            .expect("failed to compile")
+        };
+
+        let expected = compile(false);
+        for _ in 0..2 {
+            assert_eq!(&*compile(true), &*expected);
+        }
+    }
 }
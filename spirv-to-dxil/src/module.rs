@@ -0,0 +1,1001 @@
+use std::collections::{HashMap, HashSet};
+
+use crate::{
+    batch, CompileOptions, ConstValue, DxilObject, RuntimeConfig, ShaderStage, Specialization,
+    SpirvToDxilError, ValidatorVersion,
+};
+
+const SPIRV_MAGIC: u32 = 0x07230203;
+pub(crate) const SPIRV_HEADER_WORDS: usize = 5;
+const OP_EXTENSION: u16 = 10;
+const OP_ENTRY_POINT: u16 = 15;
+const OP_EXECUTION_MODE: u16 = 16;
+const OP_CAPABILITY: u16 = 17;
+const OP_TYPE_BOOL: u16 = 20;
+const OP_TYPE_INT: u16 = 21;
+const OP_TYPE_FLOAT: u16 = 22;
+const OP_TYPE_VECTOR: u16 = 23;
+const OP_TYPE_MATRIX: u16 = 24;
+const OP_TYPE_ARRAY: u16 = 28;
+const OP_TYPE_STRUCT: u16 = 30;
+const OP_TYPE_POINTER: u16 = 32;
+const OP_CONSTANT: u16 = 43;
+const OP_CONSTANT_COMPOSITE: u16 = 44;
+const OP_SPEC_CONSTANT_TRUE: u16 = 48;
+const OP_SPEC_CONSTANT_FALSE: u16 = 49;
+const OP_SPEC_CONSTANT: u16 = 50;
+const OP_SPEC_CONSTANT_COMPOSITE: u16 = 51;
+const OP_FUNCTION: u16 = 54;
+const OP_VARIABLE: u16 = 59;
+const OP_DECORATE: u16 = 71;
+const OP_MEMBER_DECORATE: u16 = 72;
+const OP_EXECUTION_MODE_ID: u16 = 331;
+
+const EXECUTION_MODE_EARLY_FRAGMENT_TESTS: u32 = 9;
+const EXECUTION_MODE_LOCAL_SIZE: u32 = 17;
+const EXECUTION_MODE_LOCAL_SIZE_ID: u32 = 38;
+const DECORATION_SPEC_ID: u32 = 1;
+const DECORATION_ROW_MAJOR: u32 = 4;
+const DECORATION_ARRAY_STRIDE: u32 = 6;
+const DECORATION_MATRIX_STRIDE: u32 = 7;
+const DECORATION_BUILT_IN: u32 = 11;
+const DECORATION_OFFSET: u32 = 35;
+const STORAGE_CLASS_PUSH_CONSTANT: u32 = 9;
+const BUILT_IN_WORKGROUP_SIZE: u32 = 25;
+/// Modules of this version and later list every global variable an entry point uses in its
+/// interface, including push constants.
+const SPIRV_VERSION_1_4: u32 = 0x00010400;
+
+/// A single SPIR-V instruction.
+#[derive(Debug, Copy, Clone)]
+pub(crate) struct Instruction<'a> {
+    pub opcode: u16,
+    pub operands: &'a [u32],
+}
+
+/// Iterator over the instructions following the header of a SPIR-V module.
+pub(crate) struct Instructions<'a> {
+    words: &'a [u32],
+}
+
+impl<'a> Instructions<'a> {
+    /// Validate the module header and iterate over the instruction stream.
+    pub fn new(spirv_words: &'a [u32]) -> Result<Self, SpirvToDxilError> {
+        if spirv_words.len() < SPIRV_HEADER_WORDS || spirv_words[0] != SPIRV_MAGIC {
+            return Err(SpirvToDxilError::InvalidSpirv("missing SPIR-V header"));
+        }
+
+        Ok(Self {
+            words: &spirv_words[SPIRV_HEADER_WORDS..],
+        })
+    }
+}
+
+impl<'a> Iterator for Instructions<'a> {
+    type Item = Result<Instruction<'a>, SpirvToDxilError>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        let &first = self.words.first()?;
+        let word_count = (first >> 16) as usize;
+
+        if word_count == 0 || word_count > self.words.len() {
+            self.words = &[];
+            return Some(Err(SpirvToDxilError::InvalidSpirv(
+                "instruction word count out of bounds",
+            )));
+        }
+
+        let (instruction, rest) = self.words.split_at(word_count);
+        self.words = rest;
+
+        Some(Ok(Instruction {
+            opcode: first as u16,
+            operands: &instruction[1..],
+        }))
+    }
+}
+
+/// Decode a null-terminated SPIR-V literal string, returning the string and the number of words
+/// it occupies.
+pub(crate) fn literal_string(operands: &[u32]) -> Option<(&str, usize)> {
+    let bytes: &[u8] = bytemuck::cast_slice(operands);
+    let len = bytes.iter().position(|&b| b == 0)?;
+    let str = std::str::from_utf8(&bytes[..len]).ok()?;
+    Some((str, len / 4 + 1))
+}
+
+/// Map a SPIR-V execution model to the shader stage that compiles it.
+pub(crate) fn execution_model_stage(execution_model: u32) -> ShaderStage {
+    match execution_model {
+        0 => ShaderStage::Vertex,
+        1 => ShaderStage::TesselationControl,
+        2 => ShaderStage::TesselationEvaluation,
+        3 => ShaderStage::Geometry,
+        4 => ShaderStage::Fragment,
+        5 => ShaderStage::Compute,
+        6 => ShaderStage::Kernel,
+        _ => ShaderStage::None,
+    }
+}
+
+/// An entry point declared in a [`SpirvModule`].
+#[derive(Debug, Clone)]
+pub struct EntryPoint {
+    /// Null-terminated name, ready to pass to the compiler.
+    name: Vec<u8>,
+    stage: ShaderStage,
+    execution_model: u32,
+    /// The result id of the entry point function.
+    function: u32,
+    execution_modes: Vec<u32>,
+    workgroup_size: Option<[u32; 3]>,
+    /// The constants that a `LocalSizeId` execution mode refers to, until they are resolved.
+    workgroup_size_ids: Option<[u32; 3]>,
+    push_constant_size: Option<u32>,
+}
+
+impl EntryPoint {
+    /// The name of the entry point.
+    pub fn name(&self) -> &str {
+        // SAFETY: constructed from a valid str with a trailing null.
+        unsafe { std::str::from_utf8_unchecked(&self.name[..self.name.len() - 1]) }
+    }
+
+    /// The shader stage of the entry point, derived from its execution model.
+    ///
+    /// Execution models that spirv-to-dxil cannot compile are reported as [`ShaderStage::None`].
+    pub fn stage(&self) -> ShaderStage {
+        self.stage
+    }
+
+    /// The SPIR-V `ExecutionModel` of the entry point.
+    pub fn execution_model(&self) -> u32 {
+        self.execution_model
+    }
+
+    /// The SPIR-V `ExecutionMode`s declared for the entry point, without their operands.
+    pub fn execution_modes(&self) -> &[u32] {
+        &self.execution_modes
+    }
+
+    /// The workgroup size of a compute shader, from its `LocalSize` or `LocalSizeId` execution
+    /// mode.
+    ///
+    /// A constant decorated with `BuiltIn WorkgroupSize` takes precedence over both. For
+    /// `LocalSizeId` and `WorkgroupSize`, the default values of any specialization constants are
+    /// reported.
+    pub fn workgroup_size(&self) -> Option<[u32; 3]> {
+        self.workgroup_size
+    }
+
+    /// Whether a fragment shader requests early fragment tests.
+    pub fn early_fragment_tests(&self) -> bool {
+        self.execution_modes
+            .contains(&EXECUTION_MODE_EARLY_FRAGMENT_TESTS)
+    }
+
+    /// The size in bytes of the push constant block of the entry point, as laid out by its
+    /// `Offset`, `ArrayStride` and `MatrixStride` decorations.
+    ///
+    /// Before SPIR-V 1.4, entry points do not list the push constants they use, so the largest
+    /// push constant block in the module is reported for every entry point. `None` if there is
+    /// no push constant block, or its size depends on types the scanner does not lay out.
+    pub fn push_constant_size(&self) -> Option<u32> {
+        self.push_constant_size
+    }
+}
+
+/// A specialization constant declared in a [`SpirvModule`].
+#[derive(Debug, Copy, Clone)]
+pub struct SpecConstant {
+    /// The `SpecId` that a [`Specialization`] overrides the constant with.
+    pub id: u32,
+    /// The type and default value of the constant.
+    pub default: ConstValue,
+}
+
+/// The scalar types that specialization constants can have.
+#[derive(Copy, Clone)]
+enum ScalarType {
+    Bool,
+    Int { width: u32, signed: bool },
+    Float { width: u32 },
+}
+
+impl ScalarType {
+    /// Decode a constant of this type from its literal operands.
+    fn value(self, literal: &[u32]) -> Option<ConstValue> {
+        let low = *literal.first()?;
+        let wide = || Some(u64::from(low) | u64::from(*literal.get(1)?) << 32);
+
+        Some(match self {
+            ScalarType::Int { width: 8, signed } => match signed {
+                true => ConstValue::Int8(low as i8),
+                false => ConstValue::Uint8(low as u8),
+            },
+            ScalarType::Int { width: 16, signed } => match signed {
+                true => ConstValue::Int16(low as i16),
+                false => ConstValue::Uint16(low as u16),
+            },
+            ScalarType::Int { width: 32, signed } => match signed {
+                true => ConstValue::Int32(low as i32),
+                false => ConstValue::Uint32(low),
+            },
+            ScalarType::Int { width: 64, signed } => match signed {
+                true => ConstValue::Int64(wide()? as i64),
+                false => ConstValue::Uint64(wide()?),
+            },
+            ScalarType::Float { width: 32 } => ConstValue::Float32(f32::from_bits(low)),
+            ScalarType::Float { width: 64 } => ConstValue::Float64(f64::from_bits(wide()?)),
+            _ => return None,
+        })
+    }
+}
+
+/// The size of a type that can appear in a push constant block.
+#[derive(Copy, Clone)]
+struct TypeSize {
+    /// The size in bytes, with matrices laid out without padding.
+    size: u32,
+    /// The components of a vector, or the rows of a matrix.
+    rows: u32,
+    /// The columns of a matrix, or 1.
+    columns: u32,
+}
+
+/// Lays out the types of push constant blocks as they are declared.
+///
+/// Decorations are declared before the types they apply to, so the size of each type is known
+/// as soon as it is declared.
+#[derive(Default)]
+struct PushConstantLayout {
+    offsets: HashMap<(u32, u32), u32>,
+    matrix_strides: HashMap<(u32, u32), u32>,
+    row_major: HashSet<(u32, u32)>,
+    array_strides: HashMap<u32, u32>,
+    types: HashMap<u32, TypeSize>,
+    /// The pointee of each pointer type in the `PushConstant` storage class.
+    pointers: HashMap<u32, u32>,
+    /// The size of each push constant variable.
+    variables: HashMap<u32, u32>,
+}
+
+impl PushConstantLayout {
+    fn decorate(&mut self, operands: &[u32]) {
+        if let [target, DECORATION_ARRAY_STRIDE, stride, ..] = *operands {
+            self.array_strides.insert(target, stride);
+        }
+    }
+
+    fn decorate_member(&mut self, operands: &[u32]) {
+        match *operands {
+            [structure, member, DECORATION_OFFSET, offset, ..] => {
+                self.offsets.insert((structure, member), offset);
+            }
+            [structure, member, DECORATION_MATRIX_STRIDE, stride, ..] => {
+                self.matrix_strides.insert((structure, member), stride);
+            }
+            [structure, member, DECORATION_ROW_MAJOR, ..] => {
+                self.row_major.insert((structure, member));
+            }
+            _ => {}
+        }
+    }
+
+    /// Lay out a type, with the values of the integer constants declared so far, for array lengths.
+    fn declare_type(&mut self, opcode: u16, operands: &[u32], constants: &HashMap<u32, u32>) {
+        let Some((&result, operands)) = operands.split_first() else {
+            return;
+        };
+
+        let size = match (opcode, operands) {
+            (OP_TYPE_INT | OP_TYPE_FLOAT, &[width, ..]) => TypeSize {
+                size: width / 8,
+                rows: 1,
+                columns: 1,
+            },
+            (OP_TYPE_VECTOR, &[component, count, ..]) => {
+                let Some(component) = self.types.get(&component) else {
+                    return;
+                };
+                TypeSize {
+                    size: component.size.saturating_mul(count),
+                    rows: count,
+                    columns: 1,
+                }
+            }
+            (OP_TYPE_MATRIX, &[column, count, ..]) => {
+                let Some(column) = self.types.get(&column) else {
+                    return;
+                };
+                TypeSize {
+                    size: column.size.saturating_mul(count),
+                    rows: column.rows,
+                    columns: count,
+                }
+            }
+            (OP_TYPE_ARRAY, &[element, length, ..]) => {
+                let (Some(element), Some(&length)) =
+                    (self.types.get(&element), constants.get(&length))
+                else {
+                    return;
+                };
+                let stride = self
+                    .array_strides
+                    .get(&result)
+                    .copied()
+                    .unwrap_or(element.size);
+                TypeSize {
+                    size: stride.saturating_mul(length),
+                    rows: 1,
+                    columns: 1,
+                }
+            }
+            (OP_TYPE_STRUCT, members) => {
+                let mut size = 0;
+                for (member, ty) in members.iter().enumerate() {
+                    let key = (result, member as u32);
+                    let (Some(&offset), Some(ty)) = (self.offsets.get(&key), self.types.get(ty))
+                    else {
+                        return;
+                    };
+
+                    let member_size = match self.matrix_strides.get(&key) {
+                        Some(stride) if self.row_major.contains(&key) => {
+                            stride.saturating_mul(ty.rows)
+                        }
+                        Some(stride) => stride.saturating_mul(ty.columns),
+                        None => ty.size,
+                    };
+                    size = size.max(offset.saturating_add(member_size));
+                }
+                TypeSize {
+                    size,
+                    rows: 1,
+                    columns: 1,
+                }
+            }
+            (OP_TYPE_POINTER, &[STORAGE_CLASS_PUSH_CONSTANT, pointee, ..]) => {
+                self.pointers.insert(result, pointee);
+                return;
+            }
+            _ => return,
+        };
+
+        self.types.insert(result, size);
+    }
+
+    fn declare_variable(&mut self, operands: &[u32]) {
+        let [pointer, result, STORAGE_CLASS_PUSH_CONSTANT, ..] = *operands else {
+            return;
+        };
+
+        if let Some(ty) = self
+            .pointers
+            .get(&pointer)
+            .and_then(|pointee| self.types.get(pointee))
+        {
+            self.variables.insert(result, ty.size);
+        }
+    }
+}
+
+/// A SPIR-V module that has been validated and indexed once, to compile any number of its
+/// entry points or specialization variants.
+///
+/// Indexing reads the declarations at the start of the module in a single pass, and stops at the
+/// first function body. Besides the entry points and their execution modes, it records the
+/// capabilities, extensions and specialization constants that the module declares, which is
+/// enough to route or reject a module before paying for a compile.
+///
+/// spirv-to-dxil selects the entry point while translating SPIR-V to NIR, so the native compiler
+/// parses the module again for every entry point it compiles. Only the indexing here is shared.
+/// To keep that cost proportional to each entry point rather than to the whole module, set
+/// [`CompileOptions::strip_dead_code`], so that each compile is handed only the code its entry
+/// point uses. [`compile_all`](SpirvModule::compile_all) compiles every entry point in
+/// parallel. Likewise, specialization constants are applied
+/// during translation, so [`compile_variants`](SpirvModule::compile_variants) compiles each
+/// variant independently and in parallel.
+pub struct SpirvModule<'a> {
+    words: &'a [u32],
+    entry_points: Vec<EntryPoint>,
+    capabilities: Vec<u32>,
+    extensions: Vec<&'a str>,
+    spec_constants: Vec<SpecConstant>,
+}
+
+impl<'a> SpirvModule<'a> {
+    /// Index the entry points of a SPIR-V module.
+    pub fn new(spirv_words: &'a [u32]) -> Result<Self, SpirvToDxilError> {
+        let mut module = Self {
+            words: spirv_words,
+            entry_points: Vec::new(),
+            capabilities: Vec::new(),
+            extensions: Vec::new(),
+            spec_constants: Vec::new(),
+        };
+
+        // Decorations and types are declared before the constants that use them, and are only
+        // kept for the few instructions that need them.
+        let mut spec_ids: HashMap<u32, u32> = HashMap::new();
+        let mut scalar_types: HashMap<u32, ScalarType> = HashMap::new();
+        // The first literal word of each scalar constant, or its default value.
+        let mut constants: HashMap<u32, u32> = HashMap::new();
+        let mut workgroup_size_builtin = None;
+        let mut workgroup_size_override = None;
+        let mut push_constants = PushConstantLayout::default();
+        // The interface ids of each entry point.
+        let mut interfaces: Vec<&'a [u32]> = Vec::new();
+
+        for instruction in Instructions::new(spirv_words)? {
+            let Instruction { opcode, operands } = instruction?;
+            match opcode {
+                OP_CAPABILITY => module.capabilities.extend(operands.first()),
+                OP_EXTENSION => {
+                    let Some((name, _)) = literal_string(operands) else {
+                        return Err(SpirvToDxilError::InvalidSpirv("malformed OpExtension"));
+                    };
+                    module.extensions.push(name);
+                }
+                OP_ENTRY_POINT => {
+                    let Some((name, name_words)) = operands.get(2..).and_then(literal_string)
+                    else {
+                        return Err(SpirvToDxilError::InvalidSpirv("malformed OpEntryPoint"));
+                    };
+                    interfaces.push(operands.get(2 + name_words..).unwrap_or_default());
+
+                    let mut name = String::from(name).into_bytes();
+                    name.push(0);
+
+                    module.entry_points.push(EntryPoint {
+                        name,
+                        stage: execution_model_stage(operands[0]),
+                        execution_model: operands[0],
+                        function: operands[1],
+                        execution_modes: Vec::new(),
+                        workgroup_size: None,
+                        workgroup_size_ids: None,
+                        push_constant_size: None,
+                    });
+                }
+                OP_EXECUTION_MODE | OP_EXECUTION_MODE_ID => {
+                    let [function, mode, ref arguments @ ..] = *operands else {
+                        return Err(SpirvToDxilError::InvalidSpirv("malformed OpExecutionMode"));
+                    };
+
+                    let size = arguments.first_chunk::<3>().copied();
+                    for entry_point in &mut module.entry_points {
+                        if entry_point.function != function {
+                            continue;
+                        }
+
+                        entry_point.execution_modes.push(mode);
+                        match mode {
+                            EXECUTION_MODE_LOCAL_SIZE => entry_point.workgroup_size = size,
+                            EXECUTION_MODE_LOCAL_SIZE_ID => entry_point.workgroup_size_ids = size,
+                            _ => {}
+                        }
+                    }
+                }
+                OP_DECORATE => {
+                    if let [target, DECORATION_SPEC_ID, spec_id, ..] = *operands {
+                        spec_ids.insert(target, spec_id);
+                    }
+                    if let [target, DECORATION_BUILT_IN, BUILT_IN_WORKGROUP_SIZE, ..] = *operands {
+                        workgroup_size_builtin = Some(target);
+                    }
+                    push_constants.decorate(operands);
+                }
+                OP_MEMBER_DECORATE => push_constants.decorate_member(operands),
+                OP_TYPE_VECTOR | OP_TYPE_MATRIX | OP_TYPE_ARRAY | OP_TYPE_STRUCT
+                | OP_TYPE_POINTER => push_constants.declare_type(opcode, operands, &constants),
+                OP_VARIABLE => push_constants.declare_variable(operands),
+                OP_TYPE_BOOL | OP_TYPE_INT | OP_TYPE_FLOAT => {
+                    push_constants.declare_type(opcode, operands, &constants);
+                    let scalar = match (opcode, operands) {
+                        (OP_TYPE_BOOL, _) => ScalarType::Bool,
+                        (OP_TYPE_INT, &[_, width, signed, ..]) => ScalarType::Int {
+                            width,
+                            signed: signed != 0,
+                        },
+                        (OP_TYPE_FLOAT, &[_, width, ..]) => ScalarType::Float { width },
+                        _ => continue,
+                    };
+                    scalar_types.extend(operands.first().map(|&id| (id, scalar)));
+                }
+                OP_CONSTANT | OP_SPEC_CONSTANT | OP_SPEC_CONSTANT_TRUE | OP_SPEC_CONSTANT_FALSE => {
+                    let [result_type, result, ref literal @ ..] = *operands else {
+                        return Err(SpirvToDxilError::InvalidSpirv("malformed constant"));
+                    };
+
+                    if opcode == OP_CONSTANT || opcode == OP_SPEC_CONSTANT {
+                        module.resolve_workgroup_size(result, literal);
+                        constants.extend(literal.first().map(|&value| (result, value)));
+                    }
+
+                    if opcode == OP_CONSTANT {
+                        continue;
+                    }
+
+                    let Some(&id) = spec_ids.get(&result) else {
+                        continue;
+                    };
+
+                    let default = match opcode {
+                        OP_SPEC_CONSTANT_TRUE => Some(ConstValue::Bool(true)),
+                        OP_SPEC_CONSTANT_FALSE => Some(ConstValue::Bool(false)),
+                        _ => scalar_types
+                            .get(&result_type)
+                            .and_then(|scalar| scalar.value(literal)),
+                    };
+
+                    if let Some(default) = default {
+                        module.spec_constants.push(SpecConstant { id, default });
+                    }
+                }
+                OP_CONSTANT_COMPOSITE | OP_SPEC_CONSTANT_COMPOSITE => {
+                    let [_, result, ref components @ ..] = *operands else {
+                        return Err(SpirvToDxilError::InvalidSpirv("malformed constant"));
+                    };
+
+                    if workgroup_size_builtin == Some(result) {
+                        let size = |id| constants.get(&id).copied();
+                        workgroup_size_override = components
+                            .first_chunk::<3>()
+                            .and_then(|&[x, y, z]| Some([size(x)?, size(y)?, size(z)?]));
+                    }
+                }
+                // Everything after the first function body is code.
+                OP_FUNCTION => break,
+                _ => {}
+            }
+        }
+
+        if let Some(size) = workgroup_size_override {
+            for entry_point in &mut module.entry_points {
+                if matches!(
+                    entry_point.stage,
+                    ShaderStage::Compute | ShaderStage::Kernel
+                ) {
+                    entry_point.workgroup_size = Some(size);
+                }
+            }
+        }
+
+        let lists_push_constants = spirv_words[1] >= SPIRV_VERSION_1_4;
+        let largest = push_constants.variables.values().copied().max();
+        for (entry_point, interface) in module.entry_points.iter_mut().zip(interfaces) {
+            entry_point.push_constant_size = interface
+                .iter()
+                .find_map(|id| push_constants.variables.get(id).copied())
+                .or(if lists_push_constants { None } else { largest });
+        }
+
+        Ok(module)
+    }
+
+    /// Fill in the workgroup size of entry points whose `LocalSizeId` refers to a constant.
+    fn resolve_workgroup_size(&mut self, result: u32, literal: &[u32]) {
+        for entry_point in &mut self.entry_points {
+            let Some(ids) = entry_point.workgroup_size_ids else {
+                continue;
+            };
+
+            for (component, &id) in ids.iter().enumerate() {
+                if id == result {
+                    entry_point.workgroup_size.get_or_insert([1; 3])[component] =
+                        literal.first().copied().unwrap_or(0);
+                }
+            }
+        }
+    }
+
+    /// The SPIR-V words of the module.
+    pub fn words(&self) -> &'a [u32] {
+        self.words
+    }
+
+    /// The entry points declared in the module.
+    pub fn entry_points(&self) -> &[EntryPoint] {
+        &self.entry_points
+    }
+
+    /// The SPIR-V `Capability` operands of the module's `OpCapability` instructions.
+    pub fn capabilities(&self) -> &[u32] {
+        &self.capabilities
+    }
+
+    /// The extensions the module enables with `OpExtension`.
+    pub fn extensions(&self) -> &[&'a str] {
+        &self.extensions
+    }
+
+    /// The specialization constants of the module, with their default values.
+    ///
+    /// Constants with a `SpecId` decoration are listed in declaration order. Composite
+    /// specialization constants, and scalar types that [`ConstValue`] cannot hold, such as
+    /// 16-bit floats, are not listed.
+    pub fn spec_constants(&self) -> &[SpecConstant] {
+        &self.spec_constants
+    }
+
+    /// Find an entry point by name.
+    ///
+    /// SPIR-V allows the same name to be shared by entry points of different stages, in which
+    /// case `stage` picks between them. If `stage` is `None`, the first match is returned.
+    pub fn entry_point(&self, name: &str, stage: Option<ShaderStage>) -> Option<&EntryPoint> {
+        self.entry_points.iter().find(|entry_point| {
+            entry_point.name() == name && stage.map_or(true, |stage| entry_point.stage == stage)
+        })
+    }
+
+    /// Compile an entry point of the module to a DXIL blob.
+    ///
+    /// See [`spirv_to_dxil_with_options`](crate::spirv_to_dxil_with_options) for details on the
+    /// parameters.
+    pub fn compile(
+        &self,
+        entry_point: &EntryPoint,
+        specializations: Option<&[Specialization]>,
+        validator_version_max: ValidatorVersion,
+        runtime_conf: &RuntimeConfig,
+        options: &CompileOptions,
+    ) -> Result<DxilObject, SpirvToDxilError> {
+        crate::spirv_to_dxil_compile(
+            self.words,
+            specializations,
+            &entry_point.name,
+            entry_point.stage,
+            validator_version_max,
+            runtime_conf,
+            options,
+        )
+        .map(|object| object.with_push_constant_size(entry_point.push_constant_size))
+    }
+
+    /// Compile every entry point of the module that spirv-to-dxil supports, in parallel.
+    ///
+    /// The native compiler parses the whole module once per entry point. For modules with many
+    /// entry points, consider setting [`CompileOptions::strip_dead_code`], so that each compile
+    /// is handed only the code its entry point uses.
+    ///
+    /// One result is returned per compiled entry point, in declaration order.
+    pub fn compile_all(
+        &self,
+        specializations: Option<&[Specialization]>,
+        validator_version_max: ValidatorVersion,
+        runtime_conf: &RuntimeConfig,
+        options: &CompileOptions,
+    ) -> Vec<(&EntryPoint, Result<DxilObject, SpirvToDxilError>)> {
+        let entry_points: Vec<&EntryPoint> = self
+            .entry_points
+            .iter()
+            .filter(|entry_point| entry_point.stage != ShaderStage::None)
+            .collect();
+
+        if let Err(err) = crate::validate_runtime_conf(runtime_conf) {
+            return entry_points
+                .into_iter()
+                .map(|entry_point| (entry_point, Err(err.clone())))
+                .collect();
+        }
+
+        let results = batch::parallel_map(&entry_points, |entry_point| {
+            let prepared = crate::PreparedSpirv::new(
+                self.words,
+                &entry_point.name,
+                entry_point.stage,
+                options,
+            );
+            crate::compile_prepared(
+                &prepared,
+                specializations,
+                &entry_point.name,
+                entry_point.stage,
+                validator_version_max,
+                runtime_conf,
+                options,
+            )
+            .map(|object| object.with_push_constant_size(entry_point.push_constant_size))
+        });
+
+        entry_points.into_iter().zip(results).collect()
+    }
+
+    /// Compile an entry point of the module once for each set of specialization constants,
+    /// in parallel.
+    ///
+    /// This is a convenience for compiling variants in parallel, and does not share compile work
+    /// between them. The native compiler applies specialization constants while it translates
+    /// SPIR-V to NIR, so every variant is decoded, translated and lowered from the SPIR-V words
+    /// again. Only the runtime config validation and the stripping requested by `options` are
+    /// done once for all variants.
+    ///
+    /// One result is returned per specialization set, in the same order as `specialization_sets`.
+    pub fn compile_variants(
+        &self,
+        entry_point: &EntryPoint,
+        specialization_sets: &[&[Specialization]],
+        validator_version_max: ValidatorVersion,
+        runtime_conf: &RuntimeConfig,
+        options: &CompileOptions,
+    ) -> Vec<Result<DxilObject, SpirvToDxilError>> {
+        if let Err(err) = crate::validate_runtime_conf(runtime_conf) {
+            return specialization_sets
+                .iter()
+                .map(|_| Err(err.clone()))
+                .collect();
+        }
+
+        let prepared =
+            crate::PreparedSpirv::new(self.words, &entry_point.name, entry_point.stage, options);
+
+        batch::parallel_map(specialization_sets, |specializations| {
+            crate::compile_prepared(
+                &prepared,
+                Some(specializations),
+                &entry_point.name,
+                entry_point.stage,
+                validator_version_max,
+                runtime_conf,
+                options,
+            )
+            .map(|object| object.with_push_constant_size(entry_point.push_constant_size))
+        })
+    }
+}
+
+#[cfg(test)]
+/// Encode an instruction.
+pub(crate) fn op(opcode: u16, operands: &[u32]) -> Vec<u32> {
+    let mut words = vec![(operands.len() as u32 + 1) << 16 | opcode as u32];
+    words.extend_from_slice(operands);
+    words
+}
+
+#[cfg(test)]
+/// Encode a null-terminated literal string.
+pub(crate) fn string(str: &str) -> Vec<u32> {
+    let mut bytes = Vec::from(str);
+    bytes.resize(str.len() / 4 * 4 + 4, 0);
+    bytes
+        .chunks_exact(4)
+        .map(|word| u32::from_le_bytes(word.try_into().unwrap()))
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::ConstValue;
+
+    #[test]
+    fn test_module_entry_points() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment: &[u32] = bytemuck::cast_slice(&fragment);
+
+        let module = SpirvModule::new(fragment).expect("failed to parse module");
+        let entry_point = module
+            .entry_point("main", Some(ShaderStage::Fragment))
+            .expect("missing entry point");
+
+        module
+            .compile(
+                entry_point,
+                None,
+                ValidatorVersion::None,
+                &RuntimeConfig::default(),
+                &CompileOptions::default(),
+            )
+            .expect("failed to compile");
+
+        let results = module.compile_all(
+            None,
+            ValidatorVersion::None,
+            &RuntimeConfig::default(),
+            &CompileOptions {
+                statistics: true,
+                ..CompileOptions::default()
+            },
+        );
+        assert_eq!(results.len(), 1);
+        for (_, result) in results {
+            let object = result.expect("failed to compile");
+            assert!(object.statistics().is_some());
+        }
+    }
+
+    #[test]
+    fn test_module_scan() {
+        let words = [
+            vec![SPIRV_MAGIC, 0x00010000, 0, 30, 0],
+            op(OP_CAPABILITY, &[1]),
+            op(OP_CAPABILITY, &[11]),
+            op(
+                OP_EXTENSION,
+                &string("SPV_KHR_storage_buffer_storage_class"),
+            ),
+            op(14, &[0, 1]),
+            op(
+                OP_ENTRY_POINT,
+                &[[5, 1].as_slice(), &string("main")].concat(),
+            ),
+            op(
+                OP_ENTRY_POINT,
+                &[[4, 2].as_slice(), &string("frag")].concat(),
+            ),
+            op(
+                OP_EXECUTION_MODE_ID,
+                &[1, EXECUTION_MODE_LOCAL_SIZE_ID, 10, 11, 11],
+            ),
+            op(OP_EXECUTION_MODE, &[2, EXECUTION_MODE_EARLY_FRAGMENT_TESTS]),
+            op(OP_DECORATE, &[10, DECORATION_SPEC_ID, 3]),
+            op(OP_DECORATE, &[12, DECORATION_SPEC_ID, 4]),
+            op(OP_DECORATE, &[13, DECORATION_SPEC_ID, 5]),
+            op(OP_TYPE_INT, &[20, 32, 0]),
+            op(OP_TYPE_BOOL, &[21]),
+            op(OP_TYPE_INT, &[22, 64, 1]),
+            op(OP_SPEC_CONSTANT, &[20, 10, 8]),
+            op(OP_CONSTANT, &[20, 11, 1]),
+            op(OP_SPEC_CONSTANT_TRUE, &[21, 12]),
+            op(OP_SPEC_CONSTANT, &[22, 13, -2i32 as u32, u32::MAX]),
+            op(OP_FUNCTION, &[23, 1, 0, 24]),
+            // Function bodies are not read.
+            vec![0],
+        ]
+        .concat();
+
+        let module = SpirvModule::new(&words).expect("failed to scan module");
+        assert_eq!(module.capabilities(), [1, 11]);
+        assert_eq!(
+            module.extensions(),
+            ["SPV_KHR_storage_buffer_storage_class"]
+        );
+
+        let compute = module
+            .entry_point("main", Some(ShaderStage::Compute))
+            .expect("missing entry point");
+        assert_eq!(compute.execution_model(), 5);
+        assert_eq!(compute.workgroup_size(), Some([8, 1, 1]));
+        assert!(!compute.early_fragment_tests());
+
+        let fragment = module
+            .entry_point("frag", Some(ShaderStage::Fragment))
+            .expect("missing entry point");
+        assert_eq!(fragment.workgroup_size(), None);
+        assert!(fragment.early_fragment_tests());
+
+        let spec_constants: Vec<(u32, String)> = module
+            .spec_constants()
+            .iter()
+            .map(|constant| (constant.id, format!("{:?}", constant.default)))
+            .collect();
+        assert_eq!(
+            spec_constants,
+            [
+                (3, String::from("Uint32(8)")),
+                (4, String::from("Bool(true)")),
+                (5, String::from("Int64(-2)")),
+            ]
+        );
+    }
+
+    #[test]
+    fn test_module_workgroup_size_builtin() {
+        let words = [
+            vec![SPIRV_MAGIC, 0x00010000, 0, 20, 0],
+            op(14, &[0, 1]),
+            op(
+                OP_ENTRY_POINT,
+                &[[5, 1].as_slice(), &string("main")].concat(),
+            ),
+            op(OP_EXECUTION_MODE, &[1, EXECUTION_MODE_LOCAL_SIZE, 64, 1, 1]),
+            op(OP_DECORATE, &[10, DECORATION_SPEC_ID, 0]),
+            op(
+                OP_DECORATE,
+                &[13, DECORATION_BUILT_IN, BUILT_IN_WORKGROUP_SIZE],
+            ),
+            op(OP_TYPE_INT, &[2, 32, 0]),
+            op(OP_TYPE_VECTOR, &[3, 2, 3]),
+            op(OP_SPEC_CONSTANT, &[2, 10, 16]),
+            op(OP_CONSTANT, &[2, 11, 2]),
+            op(OP_CONSTANT, &[2, 12, 1]),
+            op(OP_SPEC_CONSTANT_COMPOSITE, &[3, 13, 10, 11, 12]),
+        ]
+        .concat();
+
+        let module = SpirvModule::new(&words).expect("failed to scan module");
+        assert_eq!(module.entry_points()[0].workgroup_size(), Some([16, 2, 1]));
+    }
+
+    #[test]
+    fn test_module_push_constants() {
+        let module = |version: u32| {
+            [
+                vec![SPIRV_MAGIC, version, 0, 40, 0],
+                op(14, &[0, 1]),
+                op(
+                    OP_ENTRY_POINT,
+                    &[[0, 1].as_slice(), &string("vert"), &[30]].concat(),
+                ),
+                op(
+                    OP_ENTRY_POINT,
+                    &[[4, 2].as_slice(), &string("frag")].concat(),
+                ),
+                op(OP_DECORATE, &[26, DECORATION_ARRAY_STRIDE, 16]),
+                op(OP_MEMBER_DECORATE, &[27, 0, DECORATION_OFFSET, 0]),
+                op(OP_MEMBER_DECORATE, &[27, 0, DECORATION_MATRIX_STRIDE, 32]),
+                op(OP_MEMBER_DECORATE, &[27, 1, DECORATION_OFFSET, 96]),
+                op(OP_MEMBER_DECORATE, &[27, 2, DECORATION_OFFSET, 80]),
+                op(OP_TYPE_FLOAT, &[20, 32]),
+                op(OP_TYPE_VECTOR, &[21, 20, 4]),
+                op(OP_TYPE_MATRIX, &[22, 21, 2]),
+                op(OP_TYPE_VECTOR, &[23, 20, 2]),
+                op(OP_TYPE_INT, &[24, 32, 0]),
+                op(OP_CONSTANT, &[24, 25, 3]),
+                op(OP_TYPE_ARRAY, &[26, 20, 25]),
+                op(OP_TYPE_STRUCT, &[27, 22, 23, 26]),
+                op(OP_TYPE_POINTER, &[28, STORAGE_CLASS_PUSH_CONSTANT, 27]),
+                op(OP_VARIABLE, &[28, 29, STORAGE_CLASS_PUSH_CONSTANT]),
+                op(OP_TYPE_POINTER, &[31, 1, 21]),
+                op(OP_VARIABLE, &[31, 30, 1]),
+            ]
+            .concat()
+        };
+
+        // The matrix spans 64 bytes, the vec2 ends at 104 and the array at 128.
+        let words = module(0x00010000);
+        let module_1_0 = SpirvModule::new(&words).expect("failed to scan module");
+        for entry_point in module_1_0.entry_points() {
+            assert_eq!(entry_point.push_constant_size(), Some(128));
+        }
+
+        // From SPIR-V 1.4, only entry points that list the block in their interface use it.
+        let mut words = module(SPIRV_VERSION_1_4);
+        let vert = SPIRV_HEADER_WORDS + 3;
+        let vert_len = (words[vert] >> 16) as usize;
+        words[vert + vert_len - 1] = 29;
+        let module_1_4 = SpirvModule::new(&words).expect("failed to scan module");
+        let sizes: Vec<_> = module_1_4
+            .entry_points()
+            .iter()
+            .map(EntryPoint::push_constant_size)
+            .collect();
+        assert_eq!(sizes, [Some(128), None]);
+    }
+
+    #[test]
+    fn test_module_variants() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment: &[u32] = bytemuck::cast_slice(&fragment);
+
+        let module = SpirvModule::new(fragment).expect("failed to parse module");
+        let entry_point = module
+            .entry_point("main", Some(ShaderStage::Fragment))
+            .expect("missing entry point");
+
+        let specializations = [Specialization {
+            id: 0,
+            value: ConstValue::Uint32(1),
+            defined_on_module: false,
+        }];
+
+        let results = module.compile_variants(
+            entry_point,
+            &[&[], &specializations],
+            ValidatorVersion::None,
+            &RuntimeConfig::default(),
+            &CompileOptions {
+                strip_debug_info: true,
+                ..CompileOptions::default()
+            },
+        );
+
+        assert_eq!(results.len(), 2);
+        for result in results {
+            result.expect("failed to compile");
+        }
+    }
+}
@@ -1,29 +1,126 @@
+use crate::{CompileStatistics, DxilContainer, PassProfile, ShaderReflection, SpirvToDxilError};
 use std::ops::Deref;
 
+enum DxilStorage {
+    /// Output buffer allocated by the compiler.
+    Native(spirv_to_dxil_sys::dxil_spirv_object),
+    /// Bytes owned by Rust, such as a blob restored from a cache.
+    Owned(Box<[u8]>),
+}
+
 /// A compiled DXIL artifact.
 pub struct DxilObject {
-    inner: spirv_to_dxil_sys::dxil_spirv_object,
+    metadata: spirv_to_dxil_sys::dxil_spirv_metadata,
+    storage: DxilStorage,
+    statistics: Option<CompileStatistics>,
+    passes: Option<Box<[PassProfile]>>,
+    push_constant_size: Option<u32>,
 }
 
 impl Drop for DxilObject {
     fn drop(&mut self) {
-        unsafe {
-            // SAFETY:
-            // spirv_to_dxil_free frees only the interior buffer.
-            // https://gitlab.freedesktop.org/mesa/mesa/-/blob/7b0d00034201f8284a41370c0c3326736ae1134c/src/microsoft/spirv_to_dxil/spirv_to_dxil.c#L118
-            spirv_to_dxil_sys::spirv_to_dxil_free(&mut self.inner)
+        if let DxilStorage::Native(inner) = &mut self.storage {
+            unsafe {
+                // SAFETY:
+                // spirv_to_dxil_free frees only the interior buffer.
+                // https://gitlab.freedesktop.org/mesa/mesa/-/blob/7b0d00034201f8284a41370c0c3326736ae1134c/src/microsoft/spirv_to_dxil/spirv_to_dxil.c#L118
+                spirv_to_dxil_sys::spirv_to_dxil_free(inner)
+            }
         }
     }
 }
 
+// SAFETY:
+// The object exclusively owns its output buffer, which was allocated by the compiler and is only
+// read through shared references until it is freed on drop.
+unsafe impl Send for DxilObject {}
+unsafe impl Sync for DxilObject {}
+
 impl DxilObject {
     pub(crate) fn new(raw: spirv_to_dxil_sys::dxil_spirv_object) -> Self {
-        Self { inner: raw }
+        Self {
+            metadata: raw.metadata,
+            storage: DxilStorage::Native(raw),
+            statistics: None,
+            passes: None,
+            push_constant_size: None,
+        }
+    }
+
+    pub(crate) fn from_owned(binary: Box<[u8]>, requires_runtime_data: bool) -> Self {
+        Self {
+            metadata: spirv_to_dxil_sys::dxil_spirv_metadata {
+                requires_runtime_data,
+            },
+            storage: DxilStorage::Owned(binary),
+            statistics: None,
+            passes: None,
+            push_constant_size: None,
+        }
+    }
+
+    /// Move the blob out of the compiler's output buffer into memory owned by Rust.
+    #[cfg_attr(not(feature = "arena"), allow(dead_code))]
+    pub(crate) fn into_owned(mut self) -> Self {
+        match self.storage {
+            DxilStorage::Owned(_) => self,
+            DxilStorage::Native(_) => Self::from_owned(
+                self.to_vec().into_boxed_slice(),
+                self.requires_runtime_data(),
+            )
+            .with_statistics(self.statistics)
+            .with_passes(self.passes.take())
+            .with_push_constant_size(self.push_constant_size),
+        }
+    }
+
+    pub(crate) fn with_statistics(mut self, statistics: Option<CompileStatistics>) -> Self {
+        self.statistics = statistics;
+        self
+    }
+
+    pub(crate) fn with_passes(mut self, passes: Option<Box<[PassProfile]>>) -> Self {
+        self.passes = passes;
+        self
+    }
+
+    pub(crate) fn with_push_constant_size(mut self, push_constant_size: Option<u32>) -> Self {
+        self.push_constant_size = push_constant_size;
+        self
     }
 
     /// Returns if the compiled shader requires runtime data to be bound.
     pub fn requires_runtime_data(&self) -> bool {
-        self.inner.metadata.requires_runtime_data
+        self.metadata.requires_runtime_data
+    }
+
+    /// Returns the timings of the compile that produced this object, if they were requested with
+    /// [`CompileOptions::statistics`](crate::CompileOptions::statistics).
+    pub fn statistics(&self) -> Option<&CompileStatistics> {
+        self.statistics.as_ref()
+    }
+
+    /// Returns the NIR passes that ran during the compile that produced this object, if they were
+    /// requested with [`CompileOptions::profile_passes`](crate::CompileOptions::profile_passes).
+    ///
+    /// Passes are listed in the order each first ran.
+    pub fn passes(&self) -> Option<&[PassProfile]> {
+        self.passes.as_deref()
+    }
+
+    /// Returns a view of the parts of the compiled DXIL container.
+    pub fn container(&self) -> Result<DxilContainer<'_>, SpirvToDxilError> {
+        DxilContainer::new(self)
+    }
+
+    /// Returns the resource bindings, signatures and execution info of the compiled shader.
+    ///
+    /// See [`DxilContainer::reflect`]. Objects compiled through a [`SpirvModule`](crate::SpirvModule)
+    /// also report the size of their push constant block.
+    pub fn reflect(&self) -> Result<ShaderReflection, SpirvToDxilError> {
+        let mut reflection = self.container()?.reflect()?;
+        reflection.push_constant_size = self.push_constant_size;
+        Ok(reflection)
     }
 }
 
@@ -31,8 +128,11 @@ impl Deref for DxilObject {
     type Target = [u8];
 
     fn deref(&self) -> &Self::Target {
-        unsafe {
-            std::slice::from_raw_parts(self.inner.binary.buffer.cast(), self.inner.binary.size)
+        match &self.storage {
+            DxilStorage::Native(inner) => unsafe {
+                std::slice::from_raw_parts(inner.binary.buffer.cast(), inner.binary.size)
+            },
+            DxilStorage::Owned(binary) => binary,
         }
     }
 }
@@ -0,0 +1,111 @@
+use std::time::Duration;
+
+/// Additional options for a compile that are not part of the [`RuntimeConfig`](crate::RuntimeConfig).
+#[derive(Debug, Default, Copy, Clone)]
+pub struct CompileOptions {
+    /// Collect [`CompileStatistics`] for the compile.
+    pub statistics: bool,
+    /// Serve the compiler's internal allocations from a per-thread bump arena instead of the
+    /// system allocator.
+    ///
+    /// The arena is kept between compiles on the same thread. This removes most allocator
+    /// overhead and contention when many shaders are compiled in parallel. The compiled blob is
+    /// copied out of the arena before it is returned.
+    ///
+    /// Requires the `arena` feature, and is ignored otherwise.
+    pub arena: bool,
+    /// Remove the functions and declarations that the entry point does not use before compiling,
+    /// with [`strip_dead_code`](crate::strip_dead_code).
+    ///
+    /// This saves translating unused code when compiling one entry point of a large module. If
+    /// the module cannot be stripped, it is compiled as is.
+    pub strip_dead_code: bool,
+    /// Remove names, source text and line information before compiling, with
+    /// [`strip_debug_info`](crate::strip_debug_info).
+    ///
+    /// Shaders built with debug information are often several times larger than the code they
+    /// describe, and the compiler parses all of it. If the module cannot be stripped, it is
+    /// compiled as is.
+    pub strip_debug_info: bool,
+    /// Record a [`PassProfile`] for every NIR pass that runs during the compile, available from
+    /// [`DxilObject::passes`](crate::DxilObject::passes).
+    ///
+    /// Requires the `profile` feature, and is ignored otherwise.
+    pub profile_passes: bool,
+}
+
+/// Timings for the phases of a compile, collected when [`CompileOptions::statistics`] is set.
+///
+/// `translate` covers everything that happens inside the native compiler. With the `profile`
+/// feature, it is split into `parse`, `lower`, `optimize`, `emit` and `container`, which are zero
+/// otherwise. The split does not cover Mesa's setup and teardown around those phases, so their
+/// sum is slightly less than `translate`.
+///
+/// Memory usage is only counted with the `allocator` feature, and is zero otherwise.
+#[derive(Debug, Default, Copy, Clone, PartialEq, Eq)]
+pub struct CompileStatistics {
+    /// Time spent converting inputs for the native compiler, including stripping the module.
+    pub prepare: Duration,
+    /// Time spent in the native compiler.
+    pub translate: Duration,
+    /// Time spent translating SPIR-V to NIR in `spirv_to_nir`.
+    pub parse: Duration,
+    /// Time spent in the NIR lowering passes of `dxil_spirv_nir.c`.
+    pub lower: Duration,
+    /// Time spent in NIR optimization passes, the `nir_opt_*` passes and `nir_copy_prop`, both
+    /// in `dxil_spirv_nir.c` and in `nir_to_dxil`.
+    pub optimize: Duration,
+    /// Time spent emitting DXIL in `nir_to_dxil`, besides its optimization passes.
+    pub emit: Duration,
+    /// Time spent assembling the DXBC container.
+    pub container: Duration,
+    /// Time spent fakesigning the container. Zero if the blob was validated instead.
+    pub sign: Duration,
+    /// Wall time of the whole compile.
+    pub total: Duration,
+    /// The most bytes the native compiler had allocated at once.
+    pub peak_memory: usize,
+    /// The number of allocations made by the native compiler.
+    pub allocations: usize,
+    /// The number of SPIR-V words removed by [`CompileOptions::strip_dead_code`] and
+    /// [`CompileOptions::strip_debug_info`].
+    pub words_removed: usize,
+}
+
+/// How often a NIR pass ran during a compile, and for how long, collected when
+/// [`CompileOptions::profile_passes`] is set.
+///
+/// Only the passes that spirv-to-dxil runs itself are listed, not the passes that other passes
+/// run internally. The time of a pass includes any passes it runs.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct PassProfile {
+    /// The name of the function that implements the pass, such as `nir_opt_algebraic`.
+    pub name: &'static str,
+    /// The number of times the pass ran.
+    pub invocations: usize,
+    /// The number of times the pass reported that it changed the shader.
+    ///
+    /// Passes that Mesa runs with `NIR_PASS_V` never report progress.
+    pub progress: usize,
+    /// The total time spent in the pass.
+    pub time: Duration,
+}
+
+#[cfg(feature = "profile")]
+impl From<spirv_to_dxil_sys::profile::PassProfile> for PassProfile {
+    fn from(pass: spirv_to_dxil_sys::profile::PassProfile) -> Self {
+        let spirv_to_dxil_sys::profile::PassProfile {
+            name,
+            invocations,
+            progress,
+            time,
+        } = pass;
+
+        PassProfile {
+            name,
+            invocations,
+            progress,
+            time,
+        }
+    }
+}
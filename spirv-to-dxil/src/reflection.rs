@@ -0,0 +1,319 @@
+use crate::{DxilContainer, FourCC, SpirvToDxilError};
+
+/// Size of a signature element in an ISG1, OSG1 or PSG1 part.
+const SIGNATURE_ELEMENT_SIZE: usize = 32;
+/// Size of the PSV0 runtime info up to and including the signature element counts.
+const PSV_RUNTIME_INFO_1_SIZE: usize = 36;
+/// Size of the PSV0 runtime info up to and including the compute thread counts.
+const PSV_RUNTIME_INFO_2_SIZE: usize = 48;
+/// Size of the PSV0 resource binding fields that every version shares.
+const PSV_RESOURCE_BIND_INFO_0_SIZE: usize = 16;
+const PSV_SHADER_KIND_COMPUTE: u8 = 5;
+
+/// The kind of register a resource is bound to.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub enum ResourceKind {
+    /// A sampler, bound to an `s` register.
+    Sampler,
+    /// A constant buffer, bound to a `b` register.
+    ConstantBuffer,
+    /// A shader resource view, bound to a `t` register.
+    ShaderResource,
+    /// An unordered access view, bound to a `u` register.
+    UnorderedAccess,
+}
+
+/// A range of registers used by a shader.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub struct ResourceBinding {
+    /// The kind of register.
+    pub kind: ResourceKind,
+    /// The register space.
+    pub space: u32,
+    /// The first register of the range.
+    pub lower_bound: u32,
+    /// The last register of the range, or `u32::MAX` for an unbounded range.
+    pub upper_bound: u32,
+}
+
+/// An element of an input, output or patch constant signature.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub struct SignatureElement {
+    /// The semantic name, such as `TEXCOORD` or `SV_Position`.
+    pub semantic_name: String,
+    /// The semantic index.
+    pub semantic_index: u32,
+    /// The system value, as a `D3D_NAME`.
+    pub system_value: u32,
+    /// The component type, as a `D3D_REGISTER_COMPONENT_TYPE`.
+    pub component_type: u32,
+    /// The signature register.
+    pub register: u32,
+    /// The components of the register the element occupies.
+    pub mask: u8,
+    /// The geometry shader output stream.
+    pub stream: u32,
+}
+
+/// Reflection data for a compiled shader, read from its DXIL container.
+///
+/// This covers what is needed to build a root signature and to match signatures between stages,
+/// without a separate reflection pass over the SPIR-V module.
+///
+/// The native compiler does not report this data as it emits DXIL. Instead, it is parsed back
+/// out of the `PSV0` and signature parts of the finished container, which only reads those
+/// parts and not the shader itself. The push constant size is not recorded in the container,
+/// and comes from the scan of a [`SpirvModule`](crate::SpirvModule) instead.
+#[derive(Debug, Clone, Default)]
+pub struct ShaderReflection {
+    /// The register ranges the shader binds, across all register spaces.
+    pub resources: Vec<ResourceBinding>,
+    /// The input signature.
+    pub inputs: Vec<SignatureElement>,
+    /// The output signature.
+    pub outputs: Vec<SignatureElement>,
+    /// The patch constant signature of a hull or domain shader.
+    pub patch_constants: Vec<SignatureElement>,
+    /// The workgroup size of a compute shader.
+    pub workgroup_size: Option<[u32; 3]>,
+    /// Whether the shader reads `SV_ViewID`.
+    pub uses_view_id: bool,
+    /// The size in bytes of the push constant block, as reported by
+    /// [`EntryPoint::push_constant_size`](crate::EntryPoint::push_constant_size).
+    ///
+    /// Only known for objects compiled through a [`SpirvModule`](crate::SpirvModule). Reflecting
+    /// a [`DxilContainer`] directly, or an object restored from a disk cache or archive, leaves
+    /// it `None`.
+    pub push_constant_size: Option<u32>,
+}
+
+impl ShaderReflection {
+    /// The register ranges the shader binds in the given register space.
+    pub fn resources_in_space(&self, space: u32) -> impl Iterator<Item = &ResourceBinding> {
+        self.resources
+            .iter()
+            .filter(move |resource| resource.space == space)
+    }
+}
+
+/// Reads little-endian fields from a part, failing instead of reading out of bounds.
+struct Reader<'a> {
+    bytes: &'a [u8],
+}
+
+impl<'a> Reader<'a> {
+    fn bytes(&mut self, len: usize) -> Result<&'a [u8], SpirvToDxilError> {
+        if len > self.bytes.len() {
+            return Err(SpirvToDxilError::InvalidContainer(
+                "part data out of bounds",
+            ));
+        }
+
+        let (bytes, rest) = self.bytes.split_at(len);
+        self.bytes = rest;
+        Ok(bytes)
+    }
+
+    fn u32(&mut self) -> Result<u32, SpirvToDxilError> {
+        Ok(u32::from_le_bytes(self.bytes(4)?.try_into().unwrap()))
+    }
+}
+
+fn read_u32(bytes: &[u8], offset: usize) -> u32 {
+    u32::from_le_bytes(bytes[offset..offset + 4].try_into().unwrap())
+}
+
+fn resource_kind(resource_type: u32) -> Option<ResourceKind> {
+    Some(match resource_type {
+        1 => ResourceKind::Sampler,
+        2 => ResourceKind::ConstantBuffer,
+        3..=5 => ResourceKind::ShaderResource,
+        6..=9 => ResourceKind::UnorderedAccess,
+        _ => return None,
+    })
+}
+
+fn parse_signature(data: &[u8]) -> Result<Vec<SignatureElement>, SpirvToDxilError> {
+    let mut header = Reader { bytes: data };
+    let count = header.u32()? as usize;
+    let offset = header.u32()? as usize;
+
+    let Some(elements) = count
+        .checked_mul(SIGNATURE_ELEMENT_SIZE)
+        .and_then(|size| data.get(offset..offset.checked_add(size)?))
+    else {
+        return Err(SpirvToDxilError::InvalidContainer(
+            "signature elements out of bounds",
+        ));
+    };
+
+    elements
+        .chunks_exact(SIGNATURE_ELEMENT_SIZE)
+        .map(|element| {
+            let name = data
+                .get(read_u32(element, 4) as usize..)
+                .and_then(|name| name.iter().position(|&b| b == 0).map(|len| &name[..len]))
+                .ok_or(SpirvToDxilError::InvalidContainer(
+                    "semantic name out of bounds",
+                ))?;
+
+            Ok(SignatureElement {
+                semantic_name: String::from_utf8_lossy(name).into_owned(),
+                semantic_index: read_u32(element, 8),
+                system_value: read_u32(element, 12),
+                component_type: read_u32(element, 16),
+                register: read_u32(element, 20),
+                mask: element[24],
+                stream: read_u32(element, 0),
+            })
+        })
+        .collect()
+}
+
+fn parse_psv(data: &[u8], reflection: &mut ShaderReflection) -> Result<(), SpirvToDxilError> {
+    let mut psv = Reader { bytes: data };
+
+    let info_size = psv.u32()? as usize;
+    let info = psv.bytes(info_size)?;
+
+    if info.len() >= PSV_RUNTIME_INFO_1_SIZE {
+        reflection.uses_view_id = info[25] != 0;
+
+        if info[24] == PSV_SHADER_KIND_COMPUTE && info.len() >= PSV_RUNTIME_INFO_2_SIZE {
+            reflection.workgroup_size =
+                Some([read_u32(info, 36), read_u32(info, 40), read_u32(info, 44)]);
+        }
+    }
+
+    let resource_count = psv.u32()?;
+    if resource_count == 0 {
+        return Ok(());
+    }
+
+    let bind_info_size = psv.u32()? as usize;
+    if bind_info_size < PSV_RESOURCE_BIND_INFO_0_SIZE {
+        return Err(SpirvToDxilError::InvalidContainer(
+            "resource binding info too small",
+        ));
+    }
+
+    for _ in 0..resource_count {
+        let bind_info = psv.bytes(bind_info_size)?;
+        let Some(kind) = resource_kind(read_u32(bind_info, 0)) else {
+            continue;
+        };
+
+        reflection.resources.push(ResourceBinding {
+            kind,
+            space: read_u32(bind_info, 4),
+            lower_bound: read_u32(bind_info, 8),
+            upper_bound: read_u32(bind_info, 12),
+        });
+    }
+
+    Ok(())
+}
+
+impl DxilContainer<'_> {
+    /// Read the resource bindings, signatures and execution info of the shader.
+    pub fn reflect(&self) -> Result<ShaderReflection, SpirvToDxilError> {
+        let mut reflection = ShaderReflection::default();
+
+        if let Some(psv) = self.part(FourCC::PSV0) {
+            parse_psv(psv.data, &mut reflection)?;
+        }
+
+        for (fourcc, elements) in [
+            (FourCC::ISG1, &mut reflection.inputs),
+            (FourCC::OSG1, &mut reflection.outputs),
+            (FourCC::PSG1, &mut reflection.patch_constants),
+        ] {
+            if let Some(signature) = self.part(fourcc) {
+                *elements = parse_signature(signature.data)?;
+            }
+        }
+
+        Ok(reflection)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::container::assemble;
+
+    fn u32s(words: &[u32]) -> Vec<u8> {
+        words.iter().flat_map(|word| word.to_le_bytes()).collect()
+    }
+
+    #[test]
+    fn test_reflect_psv() {
+        let mut info = vec![0u8; PSV_RUNTIME_INFO_2_SIZE];
+        info[24] = PSV_SHADER_KIND_COMPUTE;
+        info[25] = 1;
+        info[36..].copy_from_slice(&u32s(&[8, 4, 2]));
+
+        let mut psv = u32s(&[info.len() as u32]);
+        psv.extend_from_slice(&info);
+        psv.extend_from_slice(&u32s(&[2, 24]));
+        psv.extend_from_slice(&u32s(&[2, 31, 1, 1, 0, 0]));
+        psv.extend_from_slice(&u32s(&[7, 0, 0, u32::MAX, 0, 0]));
+
+        let bytes = assemble(&[(FourCC::PSV0, &psv)]);
+        let reflection = DxilContainer::new(&bytes)
+            .and_then(|container| container.reflect())
+            .expect("failed to reflect");
+
+        assert_eq!(reflection.workgroup_size, Some([8, 4, 2]));
+        assert!(reflection.uses_view_id);
+        assert_eq!(
+            reflection.resources,
+            [
+                ResourceBinding {
+                    kind: ResourceKind::ConstantBuffer,
+                    space: 31,
+                    lower_bound: 1,
+                    upper_bound: 1,
+                },
+                ResourceBinding {
+                    kind: ResourceKind::UnorderedAccess,
+                    space: 0,
+                    lower_bound: 0,
+                    upper_bound: u32::MAX,
+                },
+            ]
+        );
+        assert_eq!(reflection.resources_in_space(31).count(), 1);
+    }
+
+    #[test]
+    fn test_reflect_signature() {
+        let mut signature = u32s(&[1, 8]);
+        signature.extend_from_slice(&u32s(&[0, 40, 2, 0, 3, 1, 0b0011, 0]));
+        signature.extend_from_slice(b"TEXCOORD\0");
+
+        let bytes = assemble(&[(FourCC::ISG1, &signature)]);
+        let reflection = DxilContainer::new(&bytes)
+            .and_then(|container| container.reflect())
+            .expect("failed to reflect");
+
+        assert_eq!(
+            reflection.inputs,
+            [SignatureElement {
+                semantic_name: String::from("TEXCOORD"),
+                semantic_index: 2,
+                system_value: 0,
+                component_type: 3,
+                register: 1,
+                mask: 0b0011,
+                stream: 0,
+            }]
+        );
+        assert!(reflection.outputs.is_empty());
+
+        let truncated = assemble(&[(FourCC::ISG1, &signature[..36])]);
+        assert!(DxilContainer::new(&truncated)
+            .and_then(|container| container.reflect())
+            .is_err());
+    }
+}
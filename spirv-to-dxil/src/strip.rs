@@ -0,0 +1,640 @@
+use crate::module::{literal_string, Instruction, Instructions, SPIRV_HEADER_WORDS};
+use crate::{ShaderStage, SpirvToDxilError};
+
+const OP_UNDEF: u16 = 1;
+const OP_SOURCE_CONTINUED: u16 = 2;
+const OP_SOURCE: u16 = 3;
+const OP_SOURCE_EXTENSION: u16 = 4;
+const OP_NAME: u16 = 5;
+const OP_MEMBER_NAME: u16 = 6;
+const OP_STRING: u16 = 7;
+const OP_LINE: u16 = 8;
+const OP_EXTENSION: u16 = 10;
+const OP_EXT_INST_IMPORT: u16 = 11;
+const OP_EXT_INST: u16 = 12;
+const OP_MEMORY_MODEL: u16 = 14;
+const OP_ENTRY_POINT: u16 = 15;
+const OP_EXECUTION_MODE: u16 = 16;
+const OP_CAPABILITY: u16 = 17;
+const OP_TYPE_VOID: u16 = 19;
+const OP_TYPE_PIPE: u16 = 38;
+const OP_TYPE_FORWARD_POINTER: u16 = 39;
+const OP_CONSTANT_TRUE: u16 = 41;
+const OP_CONSTANT_NULL: u16 = 46;
+const OP_SPEC_CONSTANT_TRUE: u16 = 48;
+const OP_SPEC_CONSTANT_OP: u16 = 52;
+const OP_FUNCTION: u16 = 54;
+const OP_FUNCTION_END: u16 = 56;
+const OP_VARIABLE: u16 = 59;
+const OP_DECORATE: u16 = 71;
+const OP_MEMBER_DECORATE: u16 = 72;
+const OP_GROUP_DECORATE: u16 = 74;
+const OP_GROUP_MEMBER_DECORATE: u16 = 75;
+const OP_NO_LINE: u16 = 317;
+const OP_MODULE_PROCESSED: u16 = 330;
+const OP_EXECUTION_MODE_ID: u16 = 331;
+const OP_DECORATE_ID: u16 = 332;
+const OP_DECORATE_STRING: u16 = 5632;
+const OP_MEMBER_DECORATE_STRING: u16 = 5633;
+const OP_EXT_INST_WITH_FORWARD_REFS: u16 = 4433;
+
+const DECORATION_BUILT_IN: u32 = 11;
+
+/// A SPIR-V module with instructions removed, returned by [`strip_dead_code`] and
+/// [`strip_debug_info`].
+#[derive(Debug, Clone)]
+pub struct StrippedSpirv {
+    /// The SPIR-V words of the stripped module.
+    pub words: Vec<u32>,
+    /// The number of words that were removed.
+    pub words_removed: usize,
+}
+
+impl StrippedSpirv {
+    /// The number of bytes that were removed.
+    pub fn bytes_removed(&self) -> usize {
+        self.words_removed * 4
+    }
+}
+
+/// Whether an extended instruction set only carries debug information.
+fn is_debug_info_set(name: &str) -> bool {
+    name.starts_with("NonSemantic.Shader.DebugInfo") || name == "OpenCL.DebugInfo.100"
+}
+
+/// Call `keep` with each run of consecutive instructions after the header that are not debug
+/// information, returning the number of words that were skipped.
+///
+/// This removes source text, names, line information and instructions from the debug info
+/// extended instruction sets. Strings are removed too, unless another non-semantic instruction
+/// set, such as `NonSemantic.DebugPrintf`, may refer to them.
+pub(crate) fn semantic_runs(
+    spirv_words: &[u32],
+    mut keep: impl FnMut(&[u32]),
+) -> Result<usize, SpirvToDxilError> {
+    // Validates the header.
+    Instructions::new(spirv_words)?;
+    let body = &spirv_words[SPIRV_HEADER_WORDS..];
+
+    let mut debug_sets = Vec::new();
+    let mut keep_strings = false;
+    let mut removed = 0;
+    let mut run_start = 0;
+    let mut position = 0;
+
+    while let Some(&first) = body.get(position) {
+        let word_count = (first >> 16) as usize;
+        let Some(operands) = body.get(position + 1..position + word_count) else {
+            return Err(SpirvToDxilError::InvalidSpirv(
+                "instruction word count out of bounds",
+            ));
+        };
+
+        let strip = match first as u16 {
+            OP_SOURCE_CONTINUED | OP_SOURCE | OP_SOURCE_EXTENSION | OP_NAME | OP_MEMBER_NAME
+            | OP_LINE | OP_NO_LINE | OP_MODULE_PROCESSED => true,
+            // Imports precede strings, so every set that can refer to them is known by now.
+            OP_STRING => !keep_strings,
+            OP_EXT_INST_IMPORT => match operands.get(1..).and_then(literal_string) {
+                Some((name, _)) if is_debug_info_set(name) => {
+                    debug_sets.push(operands[0]);
+                    true
+                }
+                Some((name, _)) => {
+                    keep_strings |= name.starts_with("NonSemantic.");
+                    false
+                }
+                None => false,
+            },
+            OP_EXT_INST | OP_EXT_INST_WITH_FORWARD_REFS => {
+                operands.get(2).is_some_and(|set| debug_sets.contains(set))
+            }
+            _ => false,
+        };
+
+        if strip {
+            if run_start < position {
+                keep(&body[run_start..position]);
+            }
+            removed += word_count;
+            run_start = position + word_count;
+        }
+        position += word_count;
+    }
+
+    if run_start < body.len() {
+        keep(&body[run_start..]);
+    }
+
+    Ok(removed)
+}
+
+/// Remove debug information from a SPIR-V module.
+///
+/// Names, source text, line information and the `NonSemantic.Shader.DebugInfo` and
+/// `OpenCL.DebugInfo.100` instruction sets do not affect the compiled shader, but are still
+/// parsed and kept by the compiler. This removes them in a single pass that copies the
+/// instructions in between as whole runs.
+///
+/// Resources in the compiled container lose their names.
+pub fn strip_debug_info(spirv_words: &[u32]) -> Result<StrippedSpirv, SpirvToDxilError> {
+    let mut words = Vec::with_capacity(spirv_words.len());
+    words.extend_from_slice(spirv_words.get(..SPIRV_HEADER_WORDS).unwrap_or_default());
+
+    let words_removed = semantic_runs(spirv_words, |run| words.extend_from_slice(run))?;
+    Ok(StrippedSpirv {
+        words,
+        words_removed,
+    })
+}
+
+/// The SPIR-V execution model of a shader stage.
+fn stage_execution_model(stage: ShaderStage) -> Option<u32> {
+    Some(match stage {
+        ShaderStage::Vertex => 0,
+        ShaderStage::TesselationControl => 1,
+        ShaderStage::TesselationEvaluation => 2,
+        ShaderStage::Geometry => 3,
+        ShaderStage::Fragment => 4,
+        ShaderStage::Compute => 5,
+        ShaderStage::Kernel => 6,
+        _ => return None,
+    })
+}
+
+/// The result id of a module-level declaration that can be removed when nothing refers to it.
+fn declaration_result(instruction: &Instruction) -> Option<u32> {
+    match instruction.opcode {
+        OP_TYPE_VOID..=OP_TYPE_PIPE => instruction.operands.first().copied(),
+        OP_UNDEF
+        | OP_CONSTANT_TRUE..=OP_CONSTANT_NULL
+        | OP_SPEC_CONSTANT_TRUE..=OP_SPEC_CONSTANT_OP
+        | OP_VARIABLE => instruction.operands.get(1).copied(),
+        _ => None,
+    }
+}
+
+/// Whether a module-level instruction is kept even if nothing it declares or refers to is live.
+///
+/// These are the instructions that [`declaration_result`] does not recognize, such as extended
+/// instructions and types or constants from extensions.
+fn is_always_kept(instruction: &Instruction) -> bool {
+    !matches!(
+        instruction.opcode,
+        OP_ENTRY_POINT
+            | OP_EXECUTION_MODE
+            | OP_EXECUTION_MODE_ID
+            | OP_NAME
+            | OP_MEMBER_NAME
+            | OP_DECORATE
+            | OP_MEMBER_DECORATE
+            | OP_DECORATE_ID
+            | OP_DECORATE_STRING
+            | OP_MEMBER_DECORATE_STRING
+            | OP_TYPE_FORWARD_POINTER
+    ) && declaration_result(instruction).is_none()
+}
+
+/// Whether an instruction has only literal operands, or refers only to strings, which are
+/// always kept.
+fn has_literal_operands(opcode: u16) -> bool {
+    matches!(
+        opcode,
+        OP_CAPABILITY
+            | OP_EXTENSION
+            | OP_EXT_INST_IMPORT
+            | OP_MEMORY_MODEL
+            | OP_STRING
+            | OP_SOURCE
+            | OP_SOURCE_CONTINUED
+            | OP_SOURCE_EXTENSION
+            | OP_LINE
+            | OP_MODULE_PROCESSED
+    )
+}
+
+/// One bit per result id of a module.
+struct IdSet(Vec<u64>);
+
+impl IdSet {
+    fn new(bound: u32) -> Self {
+        IdSet(vec![0; (bound as usize).div_ceil(64)])
+    }
+
+    /// Add an id, ignoring values outside the id bound.
+    fn insert(&mut self, id: u32) {
+        if let Some(word) = self.0.get_mut(id as usize / 64) {
+            *word |= 1 << (id % 64);
+        }
+    }
+
+    fn insert_all(&mut self, ids: &[u32]) {
+        for &id in ids {
+            self.insert(id);
+        }
+    }
+
+    fn contains(&self, id: u32) -> bool {
+        self.0
+            .get(id as usize / 64)
+            .is_some_and(|word| word & (1 << (id % 64)) != 0)
+    }
+}
+
+/// Remove the functions, types, constants and global variables that an entry point does not use.
+///
+/// spirv-to-dxil translates every function of a module to NIR before it discards the ones the
+/// entry point does not call, so compiling one entry point of a large library pays for the whole
+/// library. This keeps only the functions reachable from `entry_point`, the declarations they
+/// refer to, and the decorations and names of what is kept. Other entry points and their execution
+/// modes are removed. Ids are not renumbered.
+///
+/// Module-level instructions that are not plain declarations, such as debug info extended
+/// instructions and types or constants added by extensions, are always kept, together with
+/// everything they refer to.
+///
+/// Every operand of a kept instruction is treated as a possible id, so literals that happen to
+/// equal an id can keep an unused declaration alive, but nothing that is used is ever removed.
+pub fn strip_dead_code(
+    spirv_words: &[u32],
+    entry_point: &str,
+    stage: ShaderStage,
+) -> Result<StrippedSpirv, SpirvToDxilError> {
+    let instructions: Vec<Instruction> =
+        Instructions::new(spirv_words)?.collect::<Result<_, _>>()?;
+
+    let Some(entry_index) = instructions.iter().position(|instruction| {
+        instruction.opcode == OP_ENTRY_POINT
+            && instruction.operands.first().copied() == stage_execution_model(stage)
+            && instruction
+                .operands
+                .get(2..)
+                .and_then(literal_string)
+                .is_some_and(|(name, _)| name == entry_point)
+    }) else {
+        return Err(SpirvToDxilError::InvalidSpirv("entry point not found"));
+    };
+
+    // The entry point has an execution model and a name, so it also has a function.
+    let entry = &instructions[entry_index];
+    let function = entry.operands[1];
+    let (_, name_words) = literal_string(&entry.operands[2..]).unwrap();
+
+    // Functions follow every module-level declaration.
+    let declarations_end = instructions
+        .iter()
+        .position(|instruction| instruction.opcode == OP_FUNCTION)
+        .unwrap_or(instructions.len());
+
+    // The result id and instruction range of every function.
+    let mut functions = Vec::new();
+    let mut start = declarations_end;
+    for (index, instruction) in instructions.iter().enumerate().skip(declarations_end) {
+        match instruction.opcode {
+            OP_FUNCTION => start = index,
+            OP_FUNCTION_END => {
+                let Some(&id) = instructions[start].operands.get(1) else {
+                    return Err(SpirvToDxilError::InvalidSpirv("malformed OpFunction"));
+                };
+                functions.push((id, start..index + 1));
+            }
+            _ => {}
+        }
+    }
+
+    let mut live = IdSet::new(spirv_words[3]);
+    live.insert(function);
+    live.insert_all(&entry.operands[2 + name_words..]);
+
+    for instruction in &instructions[..declarations_end] {
+        match (instruction.opcode, instruction.operands) {
+            (OP_EXECUTION_MODE | OP_EXECUTION_MODE_ID, [target, _, ids @ ..])
+                if *target == function =>
+            {
+                live.insert_all(ids)
+            }
+            // A constant decorated as the workgroup size is used without being referred to.
+            (OP_DECORATE, [target, DECORATION_BUILT_IN, ..]) => live.insert(*target),
+            (OP_GROUP_DECORATE | OP_GROUP_MEMBER_DECORATE, ids) => live.insert_all(ids),
+            // Instructions that are kept regardless, such as debug info extended instructions,
+            // must not refer to anything that is removed.
+            (opcode, ids) if is_always_kept(instruction) && !has_literal_operands(opcode) => {
+                live.insert_all(ids)
+            }
+            _ => {}
+        }
+    }
+
+    // Mark until nothing changes. Declarations refer to earlier ones, so walking them backwards
+    // marks a whole chain at once, and only forward pointers and function pointers take another
+    // round.
+    let mut marked_functions = vec![false; functions.len()];
+    let mut marked_declarations = vec![false; declarations_end];
+    loop {
+        let mut changed = false;
+
+        for ((id, range), marked) in functions.iter().zip(&mut marked_functions) {
+            if !*marked && live.contains(*id) {
+                *marked = true;
+                changed = true;
+                for instruction in &instructions[range.clone()] {
+                    live.insert_all(instruction.operands);
+                }
+            }
+        }
+
+        for (instruction, marked) in instructions[..declarations_end]
+            .iter()
+            .zip(&mut marked_declarations)
+            .rev()
+        {
+            let target = match instruction.opcode {
+                OP_TYPE_FORWARD_POINTER | OP_DECORATE_ID => instruction.operands.first().copied(),
+                _ => declaration_result(instruction),
+            };
+
+            if !*marked && target.is_some_and(|target| live.contains(target)) {
+                *marked = true;
+                changed = true;
+                live.insert_all(instruction.operands);
+            }
+        }
+
+        if !changed {
+            break;
+        }
+    }
+
+    let mut words = Vec::with_capacity(spirv_words.len());
+    words.extend_from_slice(&spirv_words[..5]);
+
+    let mut keep_function = false;
+    for (index, instruction) in instructions.iter().enumerate() {
+        let keep = if index >= declarations_end {
+            if instruction.opcode == OP_FUNCTION {
+                keep_function = instruction
+                    .operands
+                    .get(1)
+                    .is_some_and(|&id| live.contains(id));
+            }
+            keep_function
+        } else {
+            match instruction.opcode {
+                OP_ENTRY_POINT => index == entry_index,
+                OP_EXECUTION_MODE | OP_EXECUTION_MODE_ID => {
+                    instruction.operands.first() == Some(&function)
+                }
+                OP_NAME
+                | OP_MEMBER_NAME
+                | OP_DECORATE
+                | OP_MEMBER_DECORATE
+                | OP_DECORATE_ID
+                | OP_DECORATE_STRING
+                | OP_MEMBER_DECORATE_STRING
+                | OP_TYPE_FORWARD_POINTER => instruction
+                    .operands
+                    .first()
+                    .is_some_and(|&target| live.contains(target)),
+                _ => declaration_result(instruction).map_or(true, |result| live.contains(result)),
+            }
+        };
+
+        if keep {
+            words.push((instruction.operands.len() as u32 + 1) << 16 | instruction.opcode as u32);
+            words.extend_from_slice(instruction.operands);
+        }
+    }
+
+    Ok(StrippedSpirv {
+        words_removed: spirv_words.len() - words.len(),
+        words,
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::module::{op, string};
+    use crate::SpirvModule;
+
+    #[test]
+    fn test_strip_dead_code() {
+        let words = [
+            vec![0x07230203, 0x00010000, 0, 40, 0],
+            op(17, &[1]),
+            op(14, &[0, 1]),
+            op(OP_ENTRY_POINT, &[[5, 1].as_slice(), &string("a")].concat()),
+            op(OP_ENTRY_POINT, &[[5, 2].as_slice(), &string("b")].concat()),
+            op(OP_EXECUTION_MODE, &[1, 17, 1, 1, 1]),
+            op(OP_EXECUTION_MODE, &[2, 17, 64, 1, 1]),
+            op(OP_NAME, &[[3].as_slice(), &string("helper")].concat()),
+            op(OP_NAME, &[[21].as_slice(), &string("unused")].concat()),
+            op(OP_DECORATE, &[21, 1, 7]),
+            op(OP_TYPE_VOID, &[10]),
+            op(33, &[11, 10]),
+            op(21, &[12, 32, 0]),
+            op(43, &[12, 20, 5]),
+            op(50, &[12, 21, 6]),
+            // a
+            op(OP_FUNCTION, &[10, 1, 0, 11]),
+            op(248, &[30]),
+            op(57, &[10, 31, 3]),
+            op(253, &[]),
+            op(OP_FUNCTION_END, &[]),
+            // b
+            op(OP_FUNCTION, &[10, 2, 0, 11]),
+            op(248, &[32]),
+            op(253, &[]),
+            op(OP_FUNCTION_END, &[]),
+            // helper, called by a
+            op(OP_FUNCTION, &[10, 3, 0, 11]),
+            op(248, &[33]),
+            op(253, &[]),
+            op(OP_FUNCTION_END, &[]),
+        ]
+        .concat();
+
+        let stripped = strip_dead_code(&words, "a", ShaderStage::Compute).expect("failed to strip");
+        assert_eq!(stripped.words_removed, words.len() - stripped.words.len());
+
+        let module = SpirvModule::new(&stripped.words).expect("failed to parse stripped module");
+        assert_eq!(module.entry_points().len(), 1);
+        assert_eq!(module.entry_points()[0].workgroup_size(), Some([1, 1, 1]));
+        assert!(module.spec_constants().is_empty());
+
+        let opcodes: Vec<u16> = Instructions::new(&stripped.words)
+            .unwrap()
+            .map(|instruction| instruction.unwrap().opcode)
+            .collect();
+        assert_eq!(
+            opcodes,
+            [
+                17,
+                14,
+                OP_ENTRY_POINT,
+                OP_EXECUTION_MODE,
+                OP_NAME,
+                OP_TYPE_VOID,
+                33,
+                OP_FUNCTION,
+                248,
+                57,
+                253,
+                OP_FUNCTION_END,
+                OP_FUNCTION,
+                248,
+                253,
+                OP_FUNCTION_END,
+            ]
+        );
+
+        assert!(strip_dead_code(&words, "a", ShaderStage::Fragment).is_err());
+    }
+
+    #[test]
+    fn test_strip_keeps_debug_info_references() {
+        let words = [
+            vec![0x07230203, 0x00010000, 0, 40, 0],
+            op(OP_CAPABILITY, &[1]),
+            op(
+                OP_EXT_INST_IMPORT,
+                &[[2].as_slice(), &string("NonSemantic.Shader.DebugInfo.100")].concat(),
+            ),
+            op(OP_MEMORY_MODEL, &[0, 1]),
+            op(
+                OP_ENTRY_POINT,
+                &[[5, 1].as_slice(), &string("main")].concat(),
+            ),
+            op(OP_EXECUTION_MODE, &[1, 17, 1, 1, 1]),
+            op(OP_TYPE_VOID, &[10]),
+            op(33, &[11, 10]),
+            op(22, &[12, 32]),
+            op(32, &[13, 6, 12]),
+            op(OP_VARIABLE, &[13, 14, 6]),
+            op(OP_VARIABLE, &[13, 15, 6]),
+            // DebugGlobalVariable, describing the otherwise unused variable 14.
+            op(OP_EXT_INST, &[10, 20, 2, 18, 14]),
+            op(OP_FUNCTION, &[10, 1, 0, 11]),
+            op(248, &[30]),
+            op(253, &[]),
+            op(OP_FUNCTION_END, &[]),
+        ]
+        .concat();
+
+        let stripped =
+            strip_dead_code(&words, "main", ShaderStage::Compute).expect("failed to strip");
+        let variables: Vec<u32> = Instructions::new(&stripped.words)
+            .unwrap()
+            .map(Result::unwrap)
+            .filter(|instruction| instruction.opcode == OP_VARIABLE)
+            .map(|instruction| instruction.operands[1])
+            .collect();
+        assert_eq!(variables, [14]);
+    }
+
+    #[test]
+    fn test_strip_debug_info() {
+        let words = [
+            vec![0x07230203, 0x00010000, 0, 40, 0],
+            op(17, &[1]),
+            op(
+                OP_EXT_INST_IMPORT,
+                &[[1].as_slice(), &string("GLSL.std.450")].concat(),
+            ),
+            op(
+                OP_EXT_INST_IMPORT,
+                &[[2].as_slice(), &string("NonSemantic.Shader.DebugInfo.100")].concat(),
+            ),
+            op(14, &[0, 1]),
+            op(
+                OP_ENTRY_POINT,
+                &[[5, 3].as_slice(), &string("main")].concat(),
+            ),
+            op(OP_EXECUTION_MODE, &[3, 17, 1, 1, 1]),
+            op(
+                OP_STRING,
+                &[[4].as_slice(), &string("shader.comp")].concat(),
+            ),
+            op(OP_SOURCE, &[2, 450, 4]),
+            op(OP_NAME, &[[3].as_slice(), &string("main")].concat()),
+            op(
+                OP_MEMBER_NAME,
+                &[[6].as_slice(), &[0], &string("x")].concat(),
+            ),
+            op(OP_MODULE_PROCESSED, &string("client vulkan100")),
+            op(OP_TYPE_VOID, &[10]),
+            op(33, &[11, 10]),
+            op(OP_EXT_INST, &[10, 12, 2, 1, 4]),
+            op(OP_FUNCTION, &[10, 3, 0, 11]),
+            op(248, &[30]),
+            op(OP_LINE, &[4, 1, 1]),
+            op(OP_EXT_INST, &[10, 13, 1, 31, 30]),
+            op(OP_NO_LINE, &[]),
+            op(253, &[]),
+            op(OP_FUNCTION_END, &[]),
+        ]
+        .concat();
+
+        let stripped = strip_debug_info(&words).expect("failed to strip");
+        assert_eq!(stripped.words_removed, words.len() - stripped.words.len());
+        assert_eq!(stripped.bytes_removed(), stripped.words_removed * 4);
+        assert_eq!(
+            stripped.words[..SPIRV_HEADER_WORDS],
+            words[..SPIRV_HEADER_WORDS]
+        );
+
+        let opcodes: Vec<u16> = Instructions::new(&stripped.words)
+            .unwrap()
+            .map(|instruction| instruction.unwrap().opcode)
+            .collect();
+        assert_eq!(
+            opcodes,
+            [
+                17,
+                OP_EXT_INST_IMPORT,
+                14,
+                OP_ENTRY_POINT,
+                OP_EXECUTION_MODE,
+                OP_TYPE_VOID,
+                33,
+                OP_FUNCTION,
+                248,
+                OP_EXT_INST,
+                253,
+                OP_FUNCTION_END,
+            ]
+        );
+
+        // Strings may be used by other non-semantic instruction sets.
+        let words = [
+            vec![0x07230203, 0x00010000, 0, 40, 0],
+            op(17, &[1]),
+            op(
+                OP_EXT_INST_IMPORT,
+                &[[1].as_slice(), &string("NonSemantic.DebugPrintf")].concat(),
+            ),
+            op(14, &[0, 1]),
+            op(OP_STRING, &[[4].as_slice(), &string("%d")].concat()),
+            op(OP_NAME, &[[4].as_slice(), &string("format")].concat()),
+        ]
+        .concat();
+        let stripped = strip_debug_info(&words).expect("failed to strip");
+        assert_eq!(stripped.words_removed, 4);
+
+        assert!(strip_debug_info(&[0x07230203, 0x00010000, 0, 40, 0, 0x00050005]).is_err());
+    }
+
+    #[test]
+    fn test_strip_fragment() {
+        let fragment: &[u8] = include_bytes!("../test/fragment.spv");
+        let fragment = Vec::from(fragment);
+        let fragment: &[u32] = bytemuck::cast_slice(&fragment);
+
+        let stripped =
+            strip_dead_code(fragment, "main", ShaderStage::Fragment).expect("failed to strip");
+        let module = SpirvModule::new(&stripped.words).expect("failed to parse stripped module");
+        assert!(module
+            .entry_point("main", Some(ShaderStage::Fragment))
+            .is_some());
+    }
+}